@@ -1,14 +1,39 @@
 #include <SDL2/SDL.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iomanip>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <utility>
 #include <vector>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
 
 // Screen dimensions
 const int SCREEN_WIDTH = 800;
 const int SCREEN_HEIGHT = 600;
 
+// Enemies
+const int DEFAULT_ENEMY_COUNT = 5;
+const int ENEMY_SIZE = 50;
+
+// World dimensions, the screen unless there are more enemies than fit on it
+int worldWidth = SCREEN_WIDTH;
+int worldHeight = SCREEN_HEIGHT;
+
 // Game Object Class
 class GameObject {
 public:
@@ -19,25 +44,27 @@ public:
     GameObject(int x, int y, int width, int height, SDL_Color color)
         : x(x), y(y), width(width), height(height), color(color), xVel(0), yVel(0) {}
 
+    virtual ~GameObject() {}
+
     virtual void update() {
         // Move object
         x += xVel;
         y += yVel;
 
-        // Check screen boundaries
-        if (x < 0 || x + width > SCREEN_WIDTH) {
+        // Check world boundaries
+        if (x < 0 || x + width > worldWidth) {
             xVel = -xVel;
             x += xVel;
         }
-        if (y < 0 || y + height > SCREEN_HEIGHT) {
+        if (y < 0 || y + height > worldHeight) {
             yVel = -yVel;
             y += yVel;
         }
     }
 
-    void render(SDL_Renderer* renderer) {
+    void render(SDL_Renderer* renderer, const SDL_Point& camera) {
         SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
-        SDL_Rect rect = {x, y, width, height};
+        SDL_Rect rect = {x - camera.x, y - camera.y, width, height};
         SDL_RenderFillRect(renderer, &rect);
     }
 
@@ -46,86 +73,790 @@ public:
     }
 };
 
+// Directions held down this frame, from the keyboard or a script
+struct PlayerInput {
+    bool up = false;
+    bool down = false;
+    bool left = false;
+    bool right = false;
+};
+
 // Player Class (derived from GameObject)
 class Player : public GameObject {
 public:
     int health;
+    PlayerInput input;
 
     Player(int x, int y, int width, int height, SDL_Color color, int health)
         : GameObject(x, y, width, height, color), health(health) {}
 
     void resetPosition() {
-        x = SCREEN_WIDTH / 2 - width / 2;
-        y = SCREEN_HEIGHT / 2 - height / 2;
+        x = worldWidth / 2 - width / 2;
+        y = worldHeight / 2 - height / 2;
     }
 
     void update() override {
-        const Uint8* currentKeyStates = SDL_GetKeyboardState(NULL);
         int speed = 5;
-        if (currentKeyStates[SDL_SCANCODE_UP] && y > 0) {
+        if (input.up && y > 0) {
             y -= speed;
         }
-        if (currentKeyStates[SDL_SCANCODE_DOWN] && y < SCREEN_HEIGHT - height) {
+        if (input.down && y < worldHeight - height) {
             y += speed;
         }
-        if (currentKeyStates[SDL_SCANCODE_LEFT] && x > 0) {
+        if (input.left && x > 0) {
             x -= speed;
         }
-        if (currentKeyStates[SDL_SCANCODE_RIGHT] && x < SCREEN_WIDTH - width) {
+        if (input.right && x < worldWidth - width) {
             x += speed;
         }
     }
 };
 
+// Enemies stored as parallel arrays, one slot per enemy, so each system
+// streams through only the fields it uses instead of visiting a separate
+// heap object with a vtable per enemy
+struct EntityStore {
+    std::vector<int> x, y;
+    std::vector<int> xVel, yVel;
+    std::vector<int> width, height;
+    std::vector<SDL_Color> color;
+
+    size_t size() const {
+        return x.size();
+    }
+
+    void add(int px, int py, int w, int h, SDL_Color c, int vx, int vy) {
+        x.push_back(px);
+        y.push_back(py);
+        xVel.push_back(vx);
+        yVel.push_back(vy);
+        width.push_back(w);
+        height.push_back(h);
+        color.push_back(c);
+    }
+
+    void reserve(size_t count) {
+        x.reserve(count);
+        y.reserve(count);
+        xVel.reserve(count);
+        yVel.reserve(count);
+        width.reserve(count);
+        height.reserve(count);
+        color.reserve(count);
+    }
+
+    static size_t bytesPerEntity() {
+        return 6 * sizeof(int) + sizeof(SDL_Color);
+    }
+};
+
+// Narrow phase kernels: test one rectangle against count rectangles packed
+// as x/y/w/h arrays and write the positions of those it overlaps to hits,
+// returning how many. The overlap test is SDL_HasIntersection's, done with
+// compares and masks so the loop has no data-dependent branches.
+typedef int (*OverlapKernel)(const SDL_Rect& rect, const int* x, const int* y, const int* w,
+                             const int* h, int count, int* hits);
+
+int overlapScalar(const SDL_Rect& rect, const int* x, const int* y, const int* w, const int* h,
+                  int count, int* hits) {
+    int found = 0;
+    for (int i = 0; i < count; ++i) {
+        hits[found] = i;
+        found += (rect.x < x[i] + w[i]) & (rect.x + rect.w > x[i]) &
+                 (rect.y < y[i] + h[i]) & (rect.y + rect.h > y[i]);
+    }
+    return found;
+}
+
+// Finish a vector kernel's last count - done rectangles one at a time
+static inline int overlapTail(const SDL_Rect& rect, const int* x, const int* y, const int* w,
+                              const int* h, int done, int count, int* hits, int found) {
+    int tail = overlapScalar(rect, x + done, y + done, w + done, h + done, count - done, hits + found);
+    for (int k = found; k < found + tail; ++k) {
+        hits[k] += done;
+    }
+    return found + tail;
+}
+
+#ifdef HAVE_X86_SIMD
+// Append the positions of the set bits of mask, counting from base
+static inline int compactHits(unsigned mask, int base, int* hits, int found) {
+    while (mask) {
+        hits[found++] = base + __builtin_ctz(mask);
+        mask &= mask - 1;
+    }
+    return found;
+}
+
+__attribute__((target("sse2")))
+int overlapSse2(const SDL_Rect& rect, const int* x, const int* y, const int* w, const int* h,
+                int count, int* hits) {
+    const __m128i left = _mm_set1_epi32(rect.x);
+    const __m128i right = _mm_set1_epi32(rect.x + rect.w);
+    const __m128i top = _mm_set1_epi32(rect.y);
+    const __m128i bottom = _mm_set1_epi32(rect.y + rect.h);
+    int found = 0;
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i bx = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i));
+        __m128i by = _mm_loadu_si128(reinterpret_cast<const __m128i*>(y + i));
+        __m128i bw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(w + i));
+        __m128i bh = _mm_loadu_si128(reinterpret_cast<const __m128i*>(h + i));
+        __m128i overlap = _mm_and_si128(
+            _mm_and_si128(_mm_cmpgt_epi32(_mm_add_epi32(bx, bw), left), _mm_cmpgt_epi32(right, bx)),
+            _mm_and_si128(_mm_cmpgt_epi32(_mm_add_epi32(by, bh), top), _mm_cmpgt_epi32(bottom, by)));
+        found = compactHits(_mm_movemask_ps(_mm_castsi128_ps(overlap)), i, hits, found);
+    }
+    return overlapTail(rect, x, y, w, h, i, count, hits, found);
+}
+
+__attribute__((target("avx2")))
+int overlapAvx2(const SDL_Rect& rect, const int* x, const int* y, const int* w, const int* h,
+                int count, int* hits) {
+    const __m256i left = _mm256_set1_epi32(rect.x);
+    const __m256i right = _mm256_set1_epi32(rect.x + rect.w);
+    const __m256i top = _mm256_set1_epi32(rect.y);
+    const __m256i bottom = _mm256_set1_epi32(rect.y + rect.h);
+    int found = 0;
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i bx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i));
+        __m256i by = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(y + i));
+        __m256i bw = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(w + i));
+        __m256i bh = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(h + i));
+        __m256i overlap = _mm256_and_si256(
+            _mm256_and_si256(_mm256_cmpgt_epi32(_mm256_add_epi32(bx, bw), left), _mm256_cmpgt_epi32(right, bx)),
+            _mm256_and_si256(_mm256_cmpgt_epi32(_mm256_add_epi32(by, bh), top), _mm256_cmpgt_epi32(bottom, by)));
+        found = compactHits(_mm256_movemask_ps(_mm256_castsi256_ps(overlap)), i, hits, found);
+    }
+    return overlapTail(rect, x, y, w, h, i, count, hits, found);
+}
+#endif
+
+// The fastest kernel this CPU supports, or the one named (scalar, sse2 or
+// avx2) if it is available. Returns nullptr for an unknown name.
+OverlapKernel selectOverlapKernel(const char* name, const char*& chosen) {
+    struct Choice {
+        const char* name;
+        OverlapKernel kernel;
+        bool supported;
+    };
+    const Choice choices[] = {
+#ifdef HAVE_X86_SIMD
+        {"avx2", overlapAvx2, SDL_HasAVX2() == SDL_TRUE},
+        {"sse2", overlapSse2, SDL_HasSSE2() == SDL_TRUE},
+#endif
+        {"scalar", overlapScalar, true},
+    };
+    for (const Choice& choice : choices) {
+        if (choice.supported && (!name || std::strcmp(name, choice.name) == 0)) {
+            chosen = choice.name;
+            return choice.kernel;
+        }
+    }
+    return nullptr;
+}
+
+// Broad phase: a uniform grid over the world, rebuilt every frame with a
+// counting sort. Each enemy is filed under every cell its rectangle
+// touches; cells are larger than any enemy, so that is at most four, and
+// within a cell enemies are in index order.
+//
+// The sort runs in two passes so the job system can spread it over
+// workers without atomics. Cells are split into bands of whole rows:
+// binRange sorts a chunk of enemies into its own buffer by band, then
+// fileBand gathers one band's entries from every chunk, in chunk order,
+// and sorts them into cells. Each band is written by one job only.
+const int GRID_CELL_SHIFT = 8; // 256 pixel cells
+const int GRID_BANDS = 64;
+
+class SpatialGrid {
+public:
+    int columns = 0;
+    int rows = 0;
+    std::vector<int> cellStart; // Enemies in cell c are items[cellStart[c]..cellStart[c + 1]]
+    std::vector<int> items;
+    std::vector<int> x, y, width, height; // Rectangles of items, packed for the overlap kernels
+
+    int cellCount() const {
+        return columns * rows;
+    }
+
+    int bandCount() const {
+        return (rows + rowsPerBand - 1) / rowsPerBand;
+    }
+
+    void clear(int chunkCount) {
+        columns = (worldWidth >> GRID_CELL_SHIFT) + 1;
+        rows = (worldHeight >> GRID_CELL_SHIFT) + 1;
+        rowsPerBand = (rows + GRID_BANDS - 1) / GRID_BANDS;
+        cellStart.resize(columns * rows + 1);
+        chunks.resize(chunkCount);
+        bandStart.resize(bandCount() + 1);
+    }
+
+    // Pass one: the cells of enemies [begin, end), grouped by band
+    void binRange(const EntityStore& entities, int chunk, int begin, int end) {
+        Chunk& bins = chunks[chunk];
+        bins.bandStart.assign(bandCount() + 1, 0);
+        for (int i = begin; i < end; ++i) {
+            forEachCell(entities, i, [&](int cell) { bins.bandStart[bandOf(cell) + 1]++; });
+        }
+        for (size_t b = 1; b < bins.bandStart.size(); ++b) {
+            bins.bandStart[b] += bins.bandStart[b - 1];
+        }
+        bins.entries.resize(bins.bandStart.back());
+        bins.next.assign(bins.bandStart.begin(), bins.bandStart.end() - 1);
+        for (int i = begin; i < end; ++i) {
+            forEachCell(entities, i, [&](int cell) {
+                bins.entries[bins.next[bandOf(cell)]++] =
+                    Entry{cell, i, entities.x[i], entities.y[i], entities.width[i], entities.height[i]};
+            });
+        }
+    }
+
+    // Where each band's items start
+    void allocate() {
+        bandStart[0] = 0;
+        for (int b = 0; b < bandCount(); ++b) {
+            int size = 0;
+            for (const Chunk& bins : chunks) {
+                size += bins.bandStart[b + 1] - bins.bandStart[b];
+            }
+            bandStart[b + 1] = bandStart[b] + size;
+        }
+        items.resize(bandStart.back());
+        x.resize(items.size());
+        y.resize(items.size());
+        width.resize(items.size());
+        height.resize(items.size());
+        cellStart[0] = 0;
+        cursor.resize(cellCount());
+    }
+
+    // Pass two: counting sort of one band's entries into its cells
+    void fileBand(int band) {
+        int firstCell = band * rowsPerBand * columns;
+        int endCell = std::min(rows, (band + 1) * rowsPerBand) * columns;
+        std::fill(cursor.begin() + firstCell, cursor.begin() + endCell, 0);
+        for (const Chunk& bins : chunks) {
+            for (int k = bins.bandStart[band]; k < bins.bandStart[band + 1]; ++k) {
+                cursor[bins.entries[k].cell]++;
+            }
+        }
+        int total = bandStart[band];
+        for (int cell = firstCell; cell < endCell; ++cell) {
+            int count = cursor[cell];
+            cursor[cell] = total;
+            total += count;
+            cellStart[cell + 1] = total;
+        }
+        for (const Chunk& bins : chunks) {
+            for (int k = bins.bandStart[band]; k < bins.bandStart[band + 1]; ++k) {
+                const Entry& entry = bins.entries[k];
+                int slot = cursor[entry.cell]++;
+                items[slot] = entry.item;
+                x[slot] = entry.x;
+                y[slot] = entry.y;
+                width[slot] = entry.width;
+                height[slot] = entry.height;
+            }
+        }
+    }
+
+    // Cells a rectangle touches, clamped to the world
+    void cellRange(const SDL_Rect& rect, int& x0, int& y0, int& x1, int& y1) const {
+        x0 = std::max(0, rect.x >> GRID_CELL_SHIFT);
+        y0 = std::max(0, rect.y >> GRID_CELL_SHIFT);
+        x1 = std::min(columns - 1, (rect.x + rect.w - 1) >> GRID_CELL_SHIFT);
+        y1 = std::min(rows - 1, (rect.y + rect.h - 1) >> GRID_CELL_SHIFT);
+    }
+
+    // An overlap is reported only from the cell holding the top left of the
+    // intersection, so pairs sharing several cells are found once
+    int homeCell(const SDL_Rect& a, const SDL_Rect& b) const {
+        int x = std::min(columns - 1, std::max(0, std::max(a.x, b.x) >> GRID_CELL_SHIFT));
+        int y = std::min(rows - 1, std::max(0, std::max(a.y, b.y) >> GRID_CELL_SHIFT));
+        return y * columns + x;
+    }
+
+private:
+    struct Entry {
+        int cell, item;
+        int x, y, width, height;
+    };
+
+    // One chunk of enemies' cells, sorted by band
+    struct Chunk {
+        std::vector<Entry> entries;
+        std::vector<int> bandStart; // Band b's entries are entries[bandStart[b]..bandStart[b + 1]]
+        std::vector<int> next;
+    };
+
+    int rowsPerBand = 1;
+    std::vector<Chunk> chunks;
+    std::vector<int> bandStart; // Band b's items start at items[bandStart[b]]
+    std::vector<int> cursor;
+
+    int bandOf(int cell) const {
+        return cell / columns / rowsPerBand;
+    }
+
+    template <typename Visit>
+    void forEachCell(const EntityStore& entities, int i, Visit visit) const {
+        int x0, y0, x1, y1;
+        cellRange(SDL_Rect{entities.x[i], entities.y[i], entities.width[i], entities.height[i]}, x0, y0, x1, y1);
+        for (int cy = y0; cy <= y1; ++cy) {
+            for (int cx = x0; cx <= x1; ++cx) {
+                visit(cy * columns + cx);
+            }
+        }
+    }
+};
+
+// Rectangles to draw this frame, bucketed by color so each color is one
+// SDL_RenderFillRects call instead of a color change and a fill per
+// object. Buckets are drawn in the order their colors were first queued,
+// so a color queued earlier stays underneath one queued later.
+class RenderQueue {
+public:
+    // Totals over all frames
+    long drawCalls = 0; // Renderer calls, color changes included
+    long batches = 0;
+    long drawn = 0;
+    long culled = 0;
+
+    // Queue rect, in screen coordinates, unless it is entirely off screen
+    void add(const SDL_Rect& rect, SDL_Color color) {
+        if (rect.x >= SCREEN_WIDTH || rect.y >= SCREEN_HEIGHT || rect.x + rect.w <= 0 || rect.y + rect.h <= 0) {
+            culled++;
+            return;
+        }
+        Uint32 key = static_cast<Uint32>(color.r) << 24 | color.g << 16 | color.b << 8 | color.a;
+        if (last >= used || buckets[last].key != key) {
+            last = 0;
+            while (last < used && buckets[last].key != key) {
+                last++;
+            }
+            if (last == used) {
+                if (used == buckets.size()) {
+                    buckets.emplace_back();
+                }
+                buckets[used].key = key;
+                buckets[used].color = color;
+                used++;
+            }
+        }
+        buckets[last].rects.push_back(rect);
+    }
+
+    // Clear the screen, draw everything queued and empty the queue
+    void flush(SDL_Renderer* renderer) {
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+        SDL_RenderClear(renderer);
+        drawCalls += 2;
+        for (size_t b = 0; b < used; ++b) {
+            Bucket& bucket = buckets[b];
+            SDL_SetRenderDrawColor(renderer, bucket.color.r, bucket.color.g, bucket.color.b, bucket.color.a);
+            SDL_RenderFillRects(renderer, bucket.rects.data(), static_cast<int>(bucket.rects.size()));
+            drawCalls += 2;
+            batches++;
+            drawn += bucket.rects.size();
+            bucket.rects.clear(); // Keeps its capacity for the next frame
+        }
+        used = 0;
+        last = 0;
+    }
+
+private:
+    struct Bucket {
+        Uint32 key;
+        SDL_Color color;
+        std::vector<SDL_Rect> rects;
+    };
+
+    std::vector<Bucket> buckets;
+    size_t used = 0; // Buckets holding rectangles this frame
+    size_t last = 0; // Bucket of the last rectangle queued
+};
+
+// Systems timed every frame
+enum System {
+    SYSTEM_PLAYER,
+    SYSTEM_MOVEMENT,
+    SYSTEM_BROADPHASE,
+    SYSTEM_COLLISIONS,
+    SYSTEM_RENDER,
+    SYSTEM_COUNT
+};
+
+const char* const SYSTEM_NAMES[SYSTEM_COUNT] = {"player", "movement", "grid build", "collisions", "render"};
+
+struct SystemTiming {
+    double totalMs = 0;
+    double maxMs = 0;
+
+    void add(double ms) {
+        totalMs += ms;
+        if (ms > maxMs) {
+            maxMs = ms;
+        }
+    }
+};
+
+// Adds the time until it goes out of scope to a system's timing
+class ScopedTimer {
+public:
+    explicit ScopedTimer(SystemTiming& timing)
+        : timing(timing), start(std::chrono::steady_clock::now()) {}
+
+    ~ScopedTimer() {
+        timing.add(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+
+private:
+    SystemTiming& timing;
+    std::chrono::steady_clock::time_point start;
+};
+
+// A stage of the frame's job graph: body runs over [0, count) in chunks of
+// chunkSize, possibly on several workers at once, after every stage that
+// lists it as a dependent has finished. Stages write their results by item
+// or by chunk, so what they produce does not depend on who ran which chunk.
+struct JobStage {
+    System system;
+    int count = 1;
+    int chunkSize = 1;
+    std::function<void(int begin, int end, int worker)> body;
+    std::vector<JobStage*> dependents;
+    int dependencies = 0;
+
+    // Scheduling state, reset by JobSystem::run
+    std::atomic<int> unmetDependencies{0};
+    std::atomic<int> chunksStarted{0};
+    std::atomic<int> chunksLeft{0};
+    std::chrono::steady_clock::time_point started, finished;
+
+    explicit JobStage(System system) : system(system) {}
+
+    int chunks() const {
+        return std::max(1, (count + chunkSize - 1) / chunkSize);
+    }
+
+    void dependsOn(JobStage& stage) {
+        stage.dependents.push_back(this);
+        dependencies++;
+    }
+};
+
+// Work-stealing scheduler for the job graph. Every worker, including the
+// main thread as worker 0, has its own deque: a stage that becomes ready
+// pushes its chunks onto the deque of the worker that finished its last
+// dependency, which takes work from the back while idle workers steal
+// from the front of the others.
+class JobSystem {
+public:
+    explicit JobSystem(int threadCount) : workers(std::max(1, threadCount)) {
+        for (int w = 1; w < static_cast<int>(workers.size()); ++w) {
+            threads.emplace_back([this, w] { workerLoop(w); });
+        }
+    }
+
+    ~JobSystem() {
+        {
+            std::lock_guard<std::mutex> guard(sleepLock);
+            shutdown = true;
+        }
+        wake.notify_all();
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+    int threadCount() const {
+        return static_cast<int>(workers.size());
+    }
+
+    // Run the graph of stages to completion, working on it from this thread
+    void run(const std::vector<JobStage*>& stages) {
+        auto start = std::chrono::steady_clock::now();
+        for (JobStage* stage : stages) {
+            stage->unmetDependencies = stage->dependencies;
+        }
+        stagesLeft = static_cast<int>(stages.size());
+        for (JobStage* stage : stages) {
+            if (stage->dependencies == 0) {
+                release(*stage, 0);
+            }
+        }
+        while (stagesLeft > 0) {
+            if (!runOneJob(0)) {
+                std::unique_lock<std::mutex> guard(sleepLock);
+                wake.wait(guard, [this] { return queued > 0 || stagesLeft == 0; });
+            }
+        }
+        graphMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void report(long frames) const {
+        std::cout << "  job system: " << workers.size() << " threads, "
+                  << graphMs / frames << " ms/frame in the update graph" << std::endl;
+        for (size_t w = 0; w < workers.size(); ++w) {
+            const Worker& worker = workers[w];
+            std::cout << "    worker " << w << ": " << 100 * worker.busyMs / std::max(graphMs, 1e-9)
+                      << "% busy, " << worker.chunks << " chunks, " << worker.steals << " stolen" << std::endl;
+        }
+    }
+
+private:
+    struct Job {
+        JobStage* stage;
+        int chunk;
+    };
+
+    struct alignas(64) Worker {
+        std::mutex lock;
+        std::deque<Job> jobs;
+        // Statistics, written only by this worker
+        double busyMs = 0;
+        long chunks = 0;
+        long steals = 0;
+    };
+
+    std::vector<Worker> workers;
+    std::vector<std::thread> threads;
+    std::mutex sleepLock;
+    std::condition_variable wake;
+    std::atomic<int> queued{0};
+    std::atomic<int> stagesLeft{0};
+    bool shutdown = false;
+    double graphMs = 0;
+
+    void workerLoop(int w) {
+        while (true) {
+            if (runOneJob(w)) {
+                continue;
+            }
+            std::unique_lock<std::mutex> guard(sleepLock);
+            wake.wait(guard, [this] { return queued > 0 || shutdown; });
+            if (shutdown) {
+                return;
+            }
+        }
+    }
+
+    void release(JobStage& stage, int w) {
+        int chunks = stage.chunks();
+        stage.chunksStarted = 0;
+        stage.chunksLeft = chunks;
+        {
+            std::lock_guard<std::mutex> guard(workers[w].lock);
+            for (int c = chunks - 1; c >= 0; --c) {
+                workers[w].jobs.push_back(Job{&stage, c});
+            }
+        }
+        queued += chunks;
+        std::lock_guard<std::mutex> guard(sleepLock);
+        wake.notify_all();
+    }
+
+    bool takeJob(int w, Job& job) {
+        {
+            Worker& own = workers[w];
+            std::lock_guard<std::mutex> guard(own.lock);
+            if (!own.jobs.empty()) {
+                job = own.jobs.back();
+                own.jobs.pop_back();
+                return true;
+            }
+        }
+        int count = static_cast<int>(workers.size());
+        for (int k = 1; k < count; ++k) {
+            Worker& victim = workers[(w + k) % count];
+            std::lock_guard<std::mutex> guard(victim.lock);
+            if (!victim.jobs.empty()) {
+                job = victim.jobs.front();
+                victim.jobs.pop_front();
+                workers[w].steals++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool runOneJob(int w) {
+        Job job;
+        if (!takeJob(w, job)) {
+            return false;
+        }
+        queued--;
+        JobStage& stage = *job.stage;
+        auto start = std::chrono::steady_clock::now();
+        if (stage.chunksStarted++ == 0) {
+            stage.started = start;
+        }
+        int begin = job.chunk * stage.chunkSize;
+        stage.body(begin, std::min(stage.count, begin + stage.chunkSize), w);
+        auto end = std::chrono::steady_clock::now();
+        workers[w].busyMs += std::chrono::duration<double, std::milli>(end - start).count();
+        workers[w].chunks++;
+
+        if (--stage.chunksLeft == 0) {
+            stage.finished = end;
+            for (JobStage* dependent : stage.dependents) {
+                if (--dependent->unmetDependencies == 0) {
+                    release(*dependent, w);
+                }
+            }
+            if (--stagesLeft == 0) {
+                std::lock_guard<std::mutex> guard(sleepLock);
+                wake.notify_all();
+            }
+        }
+        return true;
+    }
+};
+
+// Items per job for the parallel stages
+const int ENTITY_CHUNK = 4096;
+const int CELL_CHUNK = 4096;
+
+struct EngineOptions {
+    int enemyCount = DEFAULT_ENEMY_COUNT;
+    int threadCount = 1;
+    OverlapKernel overlapKernel = overlapScalar;
+    const char* overlapKernelName = "scalar";
+    bool softwareRenderer = false; // SDL's software renderer, to check drawing without a GPU
+    bool headless = false;         // No window: draw to a surface, script the player and never lose
+    unsigned seed = 1;
+};
+
+// Headless runs steer the player through a fixed pattern: each of the
+// eight directions for 45 frames in turn
+PlayerInput scriptedInput(long frame) {
+    const int directions[8][2] = {{0, -1}, {1, -1}, {1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1}};
+    const int* direction = directions[frame / 45 % 8];
+    PlayerInput input;
+    input.up = direction[1] < 0;
+    input.down = direction[1] > 0;
+    input.left = direction[0] < 0;
+    input.right = direction[0] > 0;
+    return input;
+}
+
+PlayerInput keyboardInput() {
+    const Uint8* currentKeyStates = SDL_GetKeyboardState(NULL);
+    PlayerInput input;
+    input.up = currentKeyStates[SDL_SCANCODE_UP];
+    input.down = currentKeyStates[SDL_SCANCODE_DOWN];
+    input.left = currentKeyStates[SDL_SCANCODE_LEFT];
+    input.right = currentKeyStates[SDL_SCANCODE_RIGHT];
+    return input;
+}
+
 // Game Engine Class
 class GameEngine {
 private:
     SDL_Window* window;
+    SDL_Surface* surface; // Headless render target
     SDL_Renderer* renderer;
     bool running;
     std::unique_ptr<Player> player;
-    std::vector<std::unique_ptr<GameObject>> enemies;
+    EntityStore enemies;
+    SpatialGrid grid;
+    std::vector<std::vector<std::pair<int, int>>> chunkPairs; // Found by each chunk of cells
+    std::vector<std::pair<int, int>> enemyPairs; // Overlapping enemies this frame, in cell order
+    long pairTotal;
+    long playerHits;
+    std::mt19937 rng;
+    RenderQueue renderQueue;
+    EngineOptions options;
+    SystemTiming timings[SYSTEM_COUNT];
+    long frames;
+
+    // Per worker narrow phase state
+    struct alignas(64) Scratch {
+        std::vector<int> hits; // Kernel output, one slot per rectangle tested
+        long candidates = 0;
+    };
+    std::vector<Scratch> scratch;
+
+    // The update as a job graph
+    JobSystem jobs;
+    JobStage playerStage{SYSTEM_PLAYER};
+    JobStage moveStage{SYSTEM_MOVEMENT};
+    JobStage clearStage{SYSTEM_BROADPHASE};
+    JobStage binStage{SYSTEM_BROADPHASE};
+    JobStage allocateStage{SYSTEM_BROADPHASE};
+    JobStage fileStage{SYSTEM_BROADPHASE};
+    JobStage playerHitStage{SYSTEM_COLLISIONS};
+    JobStage pairStage{SYSTEM_COLLISIONS};
+    JobStage resolveStage{SYSTEM_COLLISIONS};
+    std::vector<JobStage*> graph;
 
 public:
-    GameEngine() : window(nullptr), renderer(nullptr), running(false), player(nullptr) {}
+    explicit GameEngine(const EngineOptions& options = EngineOptions())
+        : window(nullptr), surface(nullptr), renderer(nullptr), running(false), player(nullptr), pairTotal(0),
+          playerHits(0), options(options), frames(0), scratch(std::max(1, options.threadCount)), jobs(options.threadCount) {
+        buildGraph();
+    }
 
     bool init() {
-        if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+        if (SDL_Init(options.headless ? 0 : SDL_INIT_VIDEO) < 0) {
             std::cerr << "SDL could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
             return false;
         }
 
-        window = SDL_CreateWindow("Simple 2D Game Engine", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
-        if (!window) {
-            std::cerr << "Window could not be created! SDL_Error: " << SDL_GetError() << std::endl;
-            return false;
+        if (options.headless) {
+            surface = SDL_CreateRGBSurfaceWithFormat(0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+            if (!surface) {
+                std::cerr << "Surface could not be created! SDL_Error: " << SDL_GetError() << std::endl;
+                return false;
+            }
+            renderer = SDL_CreateSoftwareRenderer(surface);
+        } else {
+            window = SDL_CreateWindow("Simple 2D Game Engine", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
+            if (!window) {
+                std::cerr << "Window could not be created! SDL_Error: " << SDL_GetError() << std::endl;
+                return false;
+            }
+            renderer = SDL_CreateRenderer(window, -1, options.softwareRenderer ? SDL_RENDERER_SOFTWARE : SDL_RENDERER_ACCELERATED);
         }
-
-        renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
         if (!renderer) {
             std::cerr << "Renderer could not be created! SDL_Error: " << SDL_GetError() << std::endl;
             return false;
         }
 
+        // Grow the world past the screen, keeping its shape, to keep enemies
+        // as sparse as five on it
+        double scale = std::sqrt(static_cast<double>(options.enemyCount) / DEFAULT_ENEMY_COUNT);
+        worldWidth = std::max(SCREEN_WIDTH, static_cast<int>(SCREEN_WIDTH * scale));
+        worldHeight = std::max(SCREEN_HEIGHT, static_cast<int>(SCREEN_HEIGHT * scale));
+
         running = true;
-        player = std::make_unique<Player>(SCREEN_WIDTH / 2 - 25, SCREEN_HEIGHT / 2 - 25, 50, 50, SDL_Color{255, 0, 0, 255}, 3);
+        player = std::make_unique<Player>(0, 0, 50, 50, SDL_Color{255, 0, 0, 255}, 3);
+        player->resetPosition();
 
-        // Seed random number generator
-        std::srand(std::time(0));
+        // Seed random number generator. Its own generator rather than
+        // std::rand, so a seed gives the same enemies on every platform.
+        rng.seed(options.seed);
 
-        // Create some enemies
-        for (int i = 0; i < 5; ++i) {
-            int x = std::rand() % (SCREEN_WIDTH - 50);
-            int y = std::rand() % (SCREEN_HEIGHT - 50);
-            int xVel = (std::rand() % 5 + 1) * (std::rand() % 2 ? 1 : -1);
-            int yVel = (std::rand() % 5 + 1) * (std::rand() % 2 ? 1 : -1);
-            enemies.push_back(std::make_unique<GameObject>(x, y, 50, 50, SDL_Color{0, 255, 0, 255}));
-            enemies.back()->xVel = xVel;
-            enemies.back()->yVel = yVel;
+        // Create the enemies
+        enemies.reserve(options.enemyCount);
+        for (int i = 0; i < options.enemyCount; ++i) {
+            int x = randomBelow(worldWidth - ENEMY_SIZE);
+            int y = randomBelow(worldHeight - ENEMY_SIZE);
+            int xVel = (randomBelow(5) + 1) * (randomBelow(2) ? 1 : -1);
+            int yVel = (randomBelow(5) + 1) * (randomBelow(2) ? 1 : -1);
+            enemies.add(x, y, ENEMY_SIZE, ENEMY_SIZE, SDL_Color{0, 255, 0, 255}, xVel, yVel);
         }
         return true;
     }
 
+    int randomBelow(int limit) {
+        return static_cast<int>(rng() % static_cast<unsigned>(limit));
+    }
+
     void handleEvents() {
         SDL_Event event;
         while (SDL_PollEvent(&event) != 0) {
@@ -135,22 +866,187 @@ public:
         }
     }
 
+    // Movement and the grid passes run over chunks of enemies or cells on
+    // every worker. The player's collisions and resolving enemy pairs stay
+    // single jobs because their outcome depends on the order of the hits;
+    // pairs are found per chunk of cells and joined in chunk order, so
+    // every thread count gives the same frame.
+    void buildGraph() {
+        playerStage.body = [this](int, int, int) { player->update(); };
+        moveStage.chunkSize = ENTITY_CHUNK;
+        moveStage.body = [this](int begin, int end, int) { moveEnemies(begin, end); };
+        clearStage.body = [this](int, int, int) {
+            grid.clear(binStage.chunks());
+            fileStage.count = grid.bandCount();
+            pairStage.count = grid.cellCount();
+            chunkPairs.resize(pairStage.chunks());
+        };
+        binStage.chunkSize = ENTITY_CHUNK;
+        binStage.body = [this](int begin, int end, int) { grid.binRange(enemies, begin / ENTITY_CHUNK, begin, end); };
+        allocateStage.body = [this](int, int, int) {
+            grid.allocate();
+            for (Scratch& worker : scratch) {
+                worker.hits.resize(std::max(worker.hits.size(), grid.items.size()));
+            }
+        };
+        fileStage.body = [this](int begin, int, int) { grid.fileBand(begin); };
+        playerHitStage.body = [this](int, int, int worker) { checkCollisions(scratch[worker]); };
+        pairStage.chunkSize = CELL_CHUNK;
+        pairStage.body = [this](int begin, int end, int worker) {
+            findEnemyPairs(begin, end, chunkPairs[begin / CELL_CHUNK], scratch[worker]);
+        };
+        resolveStage.body = [this](int, int, int) { resolveEnemyPairs(); };
+
+        binStage.dependsOn(moveStage);
+        binStage.dependsOn(clearStage);
+        allocateStage.dependsOn(binStage);
+        fileStage.dependsOn(allocateStage);
+        playerHitStage.dependsOn(fileStage);
+        playerHitStage.dependsOn(playerStage);
+        pairStage.dependsOn(fileStage);
+        resolveStage.dependsOn(pairStage);
+        graph = {&playerStage, &moveStage, &clearStage, &binStage, &allocateStage, &fileStage,
+                 &playerHitStage, &pairStage, &resolveStage};
+    }
+
     void update() {
-        player->update();
-        for (auto& enemy : enemies) {
-            enemy->update();
+        moveStage.count = static_cast<int>(enemies.size());
+        binStage.count = moveStage.count;
+        jobs.run(graph);
+
+        // A system's time is from its first stage starting to its last finishing
+        for (int s = 0; s < SYSTEM_COUNT; ++s) {
+            bool seen = false;
+            std::chrono::steady_clock::time_point started, finished;
+            for (const JobStage* stage : graph) {
+                if (stage->system == s) {
+                    started = seen ? std::min(started, stage->started) : stage->started;
+                    finished = seen ? std::max(finished, stage->finished) : stage->finished;
+                    seen = true;
+                }
+            }
+            if (seen) {
+                timings[s].add(std::chrono::duration<double, std::milli>(finished - started).count());
+            }
         }
-        checkCollisions();
     }
 
-    void checkCollisions() {
-        for (const auto& enemy : enemies) {
-            if (checkCollision(player->getRect(), enemy->getRect())) {
-                std::cout << "Collision detected! Health: " << --player->health << std::endl;
-                player->resetPosition();
-                if (player->health <= 0) {
-                    std::cout << "Game Over!" << std::endl;
-                    running = false;
+    // GameObject::update for enemies [begin, end): move, bouncing off the
+    // world's edges. Written without branches so it vectorizes.
+    void moveEnemies(int begin, int end) {
+        int* x = enemies.x.data();
+        int* y = enemies.y.data();
+        int* xVel = enemies.xVel.data();
+        int* yVel = enemies.yVel.data();
+        const int* width = enemies.width.data();
+        const int* height = enemies.height.data();
+        for (int i = begin; i < end; ++i) {
+            int nx = x[i] + xVel[i];
+            bool bounce = nx < 0 || nx + width[i] > worldWidth;
+            x[i] = bounce ? x[i] : nx;
+            xVel[i] = bounce ? -xVel[i] : xVel[i];
+        }
+        for (int i = begin; i < end; ++i) {
+            int ny = y[i] + yVel[i];
+            bool bounce = ny < 0 || ny + height[i] > worldHeight;
+            y[i] = bounce ? y[i] : ny;
+            yVel[i] = bounce ? -yVel[i] : yVel[i];
+        }
+    }
+
+    SDL_Rect enemyRect(int i) const {
+        return SDL_Rect{enemies.x[i], enemies.y[i], enemies.width[i], enemies.height[i]};
+    }
+
+    // Lowest numbered enemy from first on that overlaps rect, or -1
+    int firstOverlap(const SDL_Rect& rect, int first, Scratch& worker) {
+        int x0, y0, x1, y1;
+        grid.cellRange(rect, x0, y0, x1, y1);
+        int found = -1;
+        for (int cy = y0; cy <= y1; ++cy) {
+            for (int cx = x0; cx <= x1; ++cx) {
+                int cell = cy * grid.columns + cx;
+                int start = grid.cellStart[cell];
+                int count = grid.cellStart[cell + 1] - start;
+                int hitCount = options.overlapKernel(rect, &grid.x[start], &grid.y[start], &grid.width[start],
+                                             &grid.height[start], count, worker.hits.data());
+                worker.candidates += count;
+                for (int h = 0; h < hitCount; ++h) {
+                    int i = grid.items[start + worker.hits[h]];
+                    if (i >= first && (found < 0 || i < found) && grid.homeCell(rect, enemyRect(i)) == cell) {
+                        found = i;
+                    }
+                }
+            }
+        }
+        return found;
+    }
+
+    // Enemies are visited in index order and the player is moved back to
+    // the middle after each hit, as when every enemy was tested in turn
+    void checkCollisions(Scratch& worker) {
+        for (int i = firstOverlap(player->getRect(), 0, worker); i >= 0;
+             i = firstOverlap(player->getRect(), i + 1, worker)) {
+            playerHits++;
+            player->resetPosition();
+            if (options.headless) {
+                continue;
+            }
+            std::cout << "Collision detected! Health: " << --player->health << std::endl;
+            if (player->health <= 0) {
+                std::cout << "Game Over!" << std::endl;
+                running = false;
+            }
+        }
+    }
+
+    // Every overlapping pair of enemies reported from cells [begin, end),
+    // in cell order then index order
+    void findEnemyPairs(int begin, int end, std::vector<std::pair<int, int>>& pairs, Scratch& worker) {
+        pairs.clear();
+        for (int cell = begin; cell < end; ++cell) {
+            int last = grid.cellStart[cell + 1];
+            for (int a = grid.cellStart[cell]; a + 1 < last; ++a) {
+                // The enemies after this one in the cell, in one kernel call
+                SDL_Rect first = {grid.x[a], grid.y[a], grid.width[a], grid.height[a]};
+                int b = a + 1;
+                int hitCount = options.overlapKernel(first, &grid.x[b], &grid.y[b], &grid.width[b],
+                                             &grid.height[b], last - b, worker.hits.data());
+                worker.candidates += last - b;
+                for (int h = 0; h < hitCount; ++h) {
+                    int j = grid.items[b + worker.hits[h]];
+                    if (grid.homeCell(first, enemyRect(j)) == cell) {
+                        pairs.emplace_back(grid.items[a], j);
+                    }
+                }
+            }
+        }
+    }
+
+    // Bounce overlapping enemies off each other: along the axis they
+    // overlap least, equal masses swap velocities if they are closing
+    void resolveEnemyPairs() {
+        enemyPairs.clear();
+        for (const auto& pairs : chunkPairs) {
+            enemyPairs.insert(enemyPairs.end(), pairs.begin(), pairs.end());
+        }
+        pairTotal += enemyPairs.size();
+        for (const auto& pair : enemyPairs) {
+            int i = pair.first;
+            int j = pair.second;
+            int overlapX = std::min(enemies.x[i] + enemies.width[i], enemies.x[j] + enemies.width[j]) -
+                           std::max(enemies.x[i], enemies.x[j]);
+            int overlapY = std::min(enemies.y[i] + enemies.height[i], enemies.y[j] + enemies.height[j]) -
+                           std::max(enemies.y[i], enemies.y[j]);
+            if (overlapX < overlapY) {
+                int closing = (enemies.x[j] - enemies.x[i]) * (enemies.xVel[i] - enemies.xVel[j]);
+                if (closing > 0) {
+                    std::swap(enemies.xVel[i], enemies.xVel[j]);
+                }
+            } else {
+                int closing = (enemies.y[j] - enemies.y[i]) * (enemies.yVel[i] - enemies.yVel[j]);
+                if (closing > 0) {
+                    std::swap(enemies.yVel[i], enemies.yVel[j]);
                 }
             }
         }
@@ -161,21 +1057,118 @@ public:
                 a.y < b.y + b.h && a.y + a.h > b.y);
     }
 
+    // Top left of the screen in the world, following the player
+    SDL_Point camera() const {
+        int x = player->x + player->width / 2 - SCREEN_WIDTH / 2;
+        int y = player->y + player->height / 2 - SCREEN_HEIGHT / 2;
+        return SDL_Point{std::max(0, std::min(x, worldWidth - SCREEN_WIDTH)),
+                         std::max(0, std::min(y, worldHeight - SCREEN_HEIGHT))};
+    }
+
+    // Only enemies in the grid cells under the screen are queued; the
+    // grid holds this frame's positions, as resolving pairs changes only
+    // velocities. Each enemy is queued from one cell, found as for pairs.
     void render() {
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-        SDL_RenderClear(renderer);
+        ScopedTimer timer(timings[SYSTEM_RENDER]);
+        SDL_Point view = camera();
+        SDL_Rect screen = {view.x, view.y, SCREEN_WIDTH, SCREEN_HEIGHT};
+        renderQueue.add(SDL_Rect{player->x - view.x, player->y - view.y, player->width, player->height}, player->color);
+        int x0, y0, x1, y1;
+        grid.cellRange(screen, x0, y0, x1, y1);
+        for (int cy = y0; cy <= y1; ++cy) {
+            for (int cx = x0; cx <= x1; ++cx) {
+                int cell = cy * grid.columns + cx;
+                for (int k = grid.cellStart[cell]; k < grid.cellStart[cell + 1]; ++k) {
+                    SDL_Rect rect = {grid.x[k], grid.y[k], grid.width[k], grid.height[k]};
+                    if (grid.homeCell(screen, rect) == cell) {
+                        renderQueue.add(SDL_Rect{rect.x - view.x, rect.y - view.y, rect.w, rect.h},
+                                        enemies.color[grid.items[k]]);
+                    }
+                }
+            }
+        }
+        renderQueue.flush(renderer);
+        SDL_RenderPresent(renderer);
+    }
 
-        player->render(renderer);
-        for (const auto& enemy : enemies) {
-            enemy->render(renderer);
+    void report() {
+        if (frames == 0) {
+            return;
+        }
+        std::cout << "Frames: " << frames << "  enemies: " << enemies.size()
+                  << "  world: " << worldWidth << "x" << worldHeight << std::endl;
+        for (int s = 0; s < SYSTEM_COUNT; ++s) {
+            std::cout << "  " << SYSTEM_NAMES[s] << ": " << timings[s].totalMs / frames
+                      << " ms/frame avg, " << timings[s].maxMs << " ms max" << std::endl;
+        }
+        long candidateTotal = 0;
+        for (const Scratch& worker : scratch) {
+            candidateTotal += worker.candidates;
+        }
+        std::cout << "  enemy pairs: " << static_cast<double>(pairTotal) / frames
+                  << " per frame, narrow phase tests: " << static_cast<double>(candidateTotal) / frames
+                  << " per frame (" << options.overlapKernelName << " kernel), grid cells: "
+                  << grid.columns * grid.rows << std::endl;
+        std::cout << "  memory per enemy: " << EntityStore::bytesPerEntity() << " bytes (was "
+                  << sizeof(GameObject) + sizeof(std::unique_ptr<GameObject>)
+                  << " plus allocator overhead)" << std::endl;
+        std::cout << "  draw calls: " << static_cast<double>(renderQueue.drawCalls) / frames << " per frame in "
+                  << static_cast<double>(renderQueue.batches) / frames << " batches"
+                  << (options.softwareRenderer || options.headless ? " (software renderer)" : "") << ", objects drawn: "
+                  << static_cast<double>(renderQueue.drawn) / frames << " of " << enemies.size() + 1
+                  << " per frame, " << static_cast<double>(renderQueue.culled) / frames
+                  << " culled at the screen edge, the rest outside the grid cells on screen" << std::endl;
+        std::cout << "  player hits: " << playerHits;
+        if (options.headless) {
+            std::cout << ", seed " << options.seed << ", checksum " << std::hex << checksum() << std::dec;
         }
+        std::cout << std::endl;
+        jobs.report(frames);
+    }
 
-        SDL_RenderPresent(renderer);
+    // FNV-1a over every enemy's position and velocity and the player's
+    // position, to compare runs with the same seed
+    unsigned long long checksum() const {
+        unsigned long long hash = 14695981039346656037ULL;
+        auto mix = [&](int value) {
+            for (int byte = 0; byte < 4; ++byte) {
+                hash = (hash ^ ((static_cast<unsigned>(value) >> (8 * byte)) & 0xff)) * 1099511628211ULL;
+            }
+        };
+        for (size_t i = 0; i < enemies.size(); ++i) {
+            mix(enemies.x[i]);
+            mix(enemies.y[i]);
+            mix(enemies.xVel[i]);
+            mix(enemies.yVel[i]);
+        }
+        mix(player->x);
+        mix(player->y);
+        return hash;
+    }
+
+    static void benchmarkHeader() {
+        std::cout << "   enemies";
+        for (int s = 0; s < SYSTEM_COUNT; ++s) {
+            std::cout << "  " << std::setw(10) << SYSTEM_NAMES[s];
+        }
+        std::cout << "       frame   (ms/frame)" << std::endl;
+    }
+
+    // One line of ms/frame by system for the entity scaling benchmark
+    void benchmarkRow(double elapsedMs) const {
+        std::cout << std::setw(10) << enemies.size() << std::fixed << std::setprecision(3);
+        for (int s = 0; s < SYSTEM_COUNT; ++s) {
+            std::cout << "  " << std::setw(10) << timings[s].totalMs / frames;
+        }
+        std::cout << "  " << std::setw(10) << elapsedMs / frames << std::defaultfloat << std::endl;
     }
 
     void clean() {
         SDL_DestroyRenderer(renderer);
-        SDL_DestroyWindow(window);
+        if (window) {
+            SDL_DestroyWindow(window);
+        }
+        SDL_FreeSurface(surface);
         SDL_Quit();
     }
 
@@ -193,8 +1186,10 @@ public:
             frameStart = SDL_GetTicks();
 
             handleEvents();
+            player->input = keyboardInput();
             update();
             render();
+            frames++;
 
             frameTime = SDL_GetTicks() - frameStart;
 
@@ -203,17 +1198,102 @@ public:
             }
         }
     }
+
+    // Run frameCount frames back to back with scripted input. Every update
+    // is one fixed step, as velocities are in pixels per frame, so only
+    // the pacing is dropped. Returns the wall time taken in milliseconds.
+    double runHeadless(long frameCount) {
+        auto start = std::chrono::steady_clock::now();
+        for (long frame = 0; frame < frameCount; ++frame) {
+            player->input = scriptedInput(frame);
+            update();
+            render();
+            frames++;
+        }
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
 };
 
 int main(int argc, char* args[]) {
-    GameEngine game;
+    EngineOptions options;
+    options.threadCount = SDL_GetCPUCount();
+    const char* kernelName = nullptr;
+    bool seeded = false;
+    bool benchmark = false;
+    long frameCount = 600;
+    bool valid = true;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(args[i], "--kernel") == 0 && i + 1 < argc) {
+            kernelName = args[++i];
+        } else if (std::strcmp(args[i], "--threads") == 0 && i + 1 < argc) {
+            options.threadCount = std::atoi(args[++i]);
+            valid = valid && options.threadCount > 0;
+        } else if (std::strcmp(args[i], "--software") == 0) {
+            options.softwareRenderer = true;
+        } else if (std::strcmp(args[i], "--headless") == 0) {
+            options.headless = true;
+        } else if (std::strcmp(args[i], "--bench") == 0) {
+            benchmark = true;
+        } else if (std::strcmp(args[i], "--frames") == 0 && i + 1 < argc) {
+            frameCount = std::atol(args[++i]);
+            valid = valid && frameCount > 0;
+        } else if (std::strcmp(args[i], "--seed") == 0 && i + 1 < argc) {
+            options.seed = static_cast<unsigned>(std::strtoul(args[++i], nullptr, 10));
+            seeded = true;
+        } else if (args[i][0] != '-') {
+            options.enemyCount = std::atoi(args[i]);
+            valid = valid && options.enemyCount >= 0;
+        } else {
+            valid = false;
+        }
+    }
+    options.overlapKernel = selectOverlapKernel(kernelName, options.overlapKernelName);
+    if (!valid || !options.overlapKernel) {
+        std::cerr << "Usage: " << args[0] << " [enemies] [--kernel scalar|sse2|avx2] [--threads n] [--software]\n"
+                  << "       " << args[0] << " [enemies] --headless [--frames n] [--seed n] [options]\n"
+                  << "       " << args[0] << " --bench [--frames n] [--seed n] [options]" << std::endl;
+        return -1;
+    }
+    if (!seeded && !options.headless && !benchmark) {
+        options.seed = static_cast<unsigned>(std::time(0));
+    }
+
+    // Headless runs of increasing size, one line of ms/frame by system each
+    if (benchmark) {
+        const int enemyCounts[] = {10, 1000, 10000, 100000};
+        std::cout << frameCount << " frames per run, " << options.threadCount << " threads, "
+                  << options.overlapKernelName << " kernel, seed " << options.seed << std::endl;
+        GameEngine::benchmarkHeader();
+        for (int enemyCount : enemyCounts) {
+            EngineOptions run = options;
+            run.enemyCount = enemyCount;
+            run.headless = true;
+            GameEngine game(run);
+            if (!game.init()) {
+                std::cerr << "Failed to initialize the game engine!" << std::endl;
+                return -1;
+            }
+            game.benchmarkRow(game.runHeadless(frameCount));
+            game.clean();
+        }
+        return 0;
+    }
+
+    GameEngine game(options);
 
     if (!game.init()) {
         std::cerr << "Failed to initialize the game engine!" << std::endl;
         return -1;
     }
 
-    game.run();
+    if (options.headless) {
+        double elapsedMs = game.runHeadless(frameCount);
+        std::cout << "Ran " << frameCount << " frames in " << elapsedMs << " ms, "
+                  << elapsedMs / frameCount << " ms/frame" << std::endl;
+    } else {
+        game.run();
+    }
+    game.report();
     game.clean();
     return 0;
 }
@@ -1,22 +1,51 @@
 #include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <unistd.h>
 #include <ncurses.h>
+#include "term_frame.h"
+#include "game_runtime.h"
+#include "thread_pool.h"
 
 #define WIDTH 30
 #define HEIGHT 20
 #define INITIAL_LENGTH 3
+#define AUTOPILOT_MAX_MOVES 200000000L // Per game; huge boards take ~cells^2/4 moves to fill
+#define AUTOPILOT_NODES_PER_STEP 16    // A* budget per cell of distance to the food
+#define AUTOPILOT_MIN_NODES 256
+#define BATCH_ENVS 4096
+#define BATCH_STEPS 2000
+#define BATCH_CHUNK 64                 // Environments per pool work item
+#define SPECIAL_FOOD_STEPS 100         // Batched special food lifetime, 10 s at the starting speed
+#define ARENA_TICKS 1000
+#define ARENA_CHUNK 32                 // Snakes per pool work item
+#define ARENA_FOOD_PER_SNAKE 2
+#define ARENA_SPAWN_TRIES 32           // Random probes before giving up until the next tick
+#define ARENA_TICK_BUDGET_US 1000
 
 typedef struct {
     int x;
     int y;
 } Point;
 
+// The body is a ring buffer: the head advances through it and the tail
+// releases cells behind it, so moving never shifts segments. occupied
+// mirrors the body on the board so self-collision is a single lookup.
 typedef struct {
     Point *body;
+    int capacity; // Power of two
+    int head;     // Index of the head in body
     int length;
+    int grow;     // Moves left during which the tail stays put
     int direction; // 0: up, 1: right, 2: down, 3: left
+    int self_hit; // The last move ran into the body
+    unsigned char *occupied; // board_width x board_height, 1 where a segment lies
+    // Every free cell, packed, and where each cell sits in that list
+    int *free_cells;
+    int *free_index; // -1 for occupied cells
+    int free_count;
 } Snake;
 
 typedef struct {
@@ -26,154 +55,221 @@ typedef struct {
 } Food;
 
 int game_over = 0;
+int game_won = 0; // The snake filled the whole board
 int score = 0;
 int high_score = 0;
 int special_active = 0;
 int wrap_around = 0; // Set to 1 to enable wrap-around mode
+int special_food = 1; // Headless runs turn this off; special food expires by wall clock
+int board_width = WIDTH; // The headless modes play on larger boards
+int board_height = HEIGHT;
+
+// Mark a cell as taken by the snake, swapping it out of the free list
+void claim_cell(Snake *snake, int cell) {
+    int index = snake->free_index[cell];
+    int last = snake->free_cells[--snake->free_count];
+    snake->free_cells[index] = last;
+    snake->free_index[last] = index;
+    snake->free_index[cell] = -1;
+    snake->occupied[cell] = 1;
+}
+
+void release_cell(Snake *snake, int cell) {
+    snake->free_index[cell] = snake->free_count;
+    snake->free_cells[snake->free_count++] = cell;
+    snake->occupied[cell] = 0;
+}
 
 void init_snake(Snake *snake) {
-    snake->body = malloc(INITIAL_LENGTH * sizeof(Point));
+    snake->capacity = 16;
+    snake->body = malloc(snake->capacity * sizeof(Point));
+    snake->occupied = calloc(board_width * board_height, 1);
+    snake->free_cells = malloc(board_width * board_height * sizeof(int));
+    snake->free_index = malloc(board_width * board_height * sizeof(int));
+    snake->free_count = board_width * board_height;
+    for (int i = 0; i < board_width * board_height; i++) {
+        snake->free_cells[i] = i;
+        snake->free_index[i] = i;
+    }
     snake->length = INITIAL_LENGTH;
+    snake->head = INITIAL_LENGTH - 1;
+    snake->grow = 0;
     snake->direction = 1; // Start moving right
+    snake->self_hit = 0;
     
-    // Initialize snake body in the middle of the screen
+    // Initialize snake body in the middle of the screen, tail first
     for (int i = 0; i < INITIAL_LENGTH; i++) {
-        snake->body[i].x = WIDTH / 2 - i;
-        snake->body[i].y = HEIGHT / 2;
+        snake->body[i].x = board_width / 2 - (INITIAL_LENGTH - 1 - i);
+        snake->body[i].y = board_height / 2;
+        claim_cell(snake, snake->body[i].y * board_width + snake->body[i].x);
+    }
+}
+
+void free_snake(Snake *snake) {
+    free(snake->body);
+    free(snake->occupied);
+    free(snake->free_cells);
+    free(snake->free_index);
+}
+
+// Segment i of the snake, counting from the head
+Point *segment(Snake *snake, int i) {
+    return &snake->body[(snake->head - i) & (snake->capacity - 1)];
+}
+
+// Double the ring, unwrapping it so the tail sits at index 0
+void grow_body(Snake *snake) {
+    Point *body = malloc(snake->capacity * 2 * sizeof(Point));
+    for (int i = 0; i < snake->length; i++) {
+        body[i] = *segment(snake, snake->length - 1 - i);
+    }
+    free(snake->body);
+    snake->body = body;
+    snake->capacity *= 2;
+    snake->head = snake->length - 1;
+}
+
+// Pick a uniformly random cell the snake does not cover. Returns 0 if
+// the board is full.
+int random_free_cell(Snake *snake, Point *cell) {
+    if (snake->free_count == 0) {
+        return 0;
     }
+    int index = snake->free_cells[rand() % snake->free_count];
+    cell->x = index % board_width;
+    cell->y = index / board_width;
+    return 1;
 }
 
-void init_food(Food *food) {
-    food->position.x = rand() % WIDTH;
-    food->position.y = rand() % HEIGHT;
+void init_food(Food *food, Snake *snake) {
+    random_free_cell(snake, &food->position);
     food->is_special = 0;
     food->spawn_time = time(NULL);
 }
 
-void generate_food(Food *food, Snake *snake) {
-    int valid;
-    do {
-        valid = 1;
-        food->position.x = rand() % WIDTH;
-        food->position.y = rand() % HEIGHT;
-        
-        // Check if food spawns on snake
-        for (int i = 0; i < snake->length; i++) {
-            if (food->position.x == snake->body[i].x && 
-                food->position.y == snake->body[i].y) {
-                valid = 0;
-                break;
-            }
-        }
-        
-        // 20% chance for special food if none is currently active
-        if (!special_active && (rand() % 5 == 0)) {
-            food->is_special = 1;
-            special_active = 1;
-        } else {
-            food->is_special = 0;
-        }
-        
-    } while (!valid);
+// Place new food on a free cell. Returns 0 if there is none left, i.e. the
+// snake has filled the board.
+int generate_food(Food *food, Snake *snake) {
+    if (!random_free_cell(snake, &food->position)) {
+        return 0;
+    }
+    
+    // 20% chance for special food if none is currently active
+    if (special_food && !special_active && (rand() % 5 == 0)) {
+        food->is_special = 1;
+        special_active = 1;
+    } else {
+        food->is_special = 0;
+    }
     
     food->spawn_time = time(NULL);
+    return 1;
 }
 
 void draw_borders() {
     // Draw top and bottom borders
     for (int i = 0; i < WIDTH + 2; i++) {
-        mvprintw(0, i, "#");
-        mvprintw(HEIGHT + 1, i, "#");
+        frame_print(0, i, 0, "#");
+        frame_print(HEIGHT + 1, i, 0, "#");
     }
     
     // Draw left and right borders
     for (int i = 1; i < HEIGHT + 1; i++) {
-        mvprintw(i, 0, "#");
-        mvprintw(i, WIDTH + 1, "#");
+        frame_print(i, 0, 0, "#");
+        frame_print(i, WIDTH + 1, 0, "#");
     }
 }
 
 void draw_snake(Snake *snake) {
     for (int i = 0; i < snake->length; i++) {
+        Point *p = segment(snake, i);
         if (i == 0) {
             // Draw head differently
-            attron(COLOR_PAIR(2));
-            mvprintw(snake->body[i].y + 1, snake->body[i].x + 1, "O");
-            attroff(COLOR_PAIR(2));
+            frame_print(p->y + 1, p->x + 1, 2, "O");
         } else {
-            attron(COLOR_PAIR(1));
-            mvprintw(snake->body[i].y + 1, snake->body[i].x + 1, "o");
-            attroff(COLOR_PAIR(1));
+            frame_print(p->y + 1, p->x + 1, 1, "o");
         }
     }
 }
 
 void draw_food(Food *food) {
     if (food->is_special) {
-        attron(COLOR_PAIR(3));
-        mvprintw(food->position.y + 1, food->position.x + 1, "@");
-        attroff(COLOR_PAIR(3));
+        frame_print(food->position.y + 1, food->position.x + 1, 3, "@");
     } else {
-        attron(COLOR_PAIR(4));
-        mvprintw(food->position.y + 1, food->position.x + 1, "*");
-        attroff(COLOR_PAIR(4));
+        frame_print(food->position.y + 1, food->position.x + 1, 4, "*");
     }
 }
 
 void update_snake(Snake *snake) {
-    // Move each segment to the position of the previous segment
-    for (int i = snake->length - 1; i > 0; i--) {
-        snake->body[i] = snake->body[i - 1];
+    Point head = *segment(snake, 0);
+    
+    // Release the tail, unless the snake is still growing
+    if (snake->grow > 0) {
+        snake->grow--;
+        if (snake->length == snake->capacity) {
+            grow_body(snake);
+        }
+        snake->length++;
+    } else {
+        Point *tail = segment(snake, snake->length - 1);
+        release_cell(snake, tail->y * board_width + tail->x);
     }
     
     // Move head based on direction
     switch (snake->direction) {
         case 0: // Up
-            snake->body[0].y--;
+            head.y--;
             break;
         case 1: // Right
-            snake->body[0].x++;
+            head.x++;
             break;
         case 2: // Down
-            snake->body[0].y++;
+            head.y++;
             break;
         case 3: // Left
-            snake->body[0].x--;
+            head.x--;
             break;
     }
     
     // Handle wrap-around if enabled
     if (wrap_around) {
-        if (snake->body[0].x >= WIDTH) snake->body[0].x = 0;
-        if (snake->body[0].x < 0) snake->body[0].x = WIDTH - 1;
-        if (snake->body[0].y >= HEIGHT) snake->body[0].y = 0;
-        if (snake->body[0].y < 0) snake->body[0].y = HEIGHT - 1;
+        if (head.x >= board_width) head.x = 0;
+        if (head.x < 0) head.x = board_width - 1;
+        if (head.y >= board_height) head.y = 0;
+        if (head.y < 0) head.y = board_height - 1;
+    }
+    
+    snake->head = (snake->head + 1) & (snake->capacity - 1);
+    snake->body[snake->head] = head;
+    
+    // Claim the new cell; a head off the board hits the wall instead
+    snake->self_hit = 0;
+    if (head.x >= 0 && head.x < board_width && head.y >= 0 && head.y < board_height) {
+        snake->self_hit = snake->occupied[head.y * board_width + head.x];
+        if (!snake->self_hit) {
+            claim_cell(snake, head.y * board_width + head.x);
+        }
     }
 }
 
 int check_collision(Snake *snake) {
     // Check wall collision (if wrap-around is disabled)
+    Point *head = segment(snake, 0);
     if (!wrap_around) {
-        if (snake->body[0].x < 0 || snake->body[0].x >= WIDTH ||
-            snake->body[0].y < 0 || snake->body[0].y >= HEIGHT) {
-            return 1;
-        }
-    }
-    
-    // Check self collision
-    for (int i = 1; i < snake->length; i++) {
-        if (snake->body[0].x == snake->body[i].x && 
-            snake->body[0].y == snake->body[i].y) {
+        if (head->x < 0 || head->x >= board_width ||
+            head->y < 0 || head->y >= board_height) {
             return 1;
         }
     }
     
-    return 0;
+    // Check self collision, found by update_snake in the occupancy grid
+    return snake->self_hit;
 }
 
 void check_food(Snake *snake, Food *food) {
-    if (snake->body[0].x == food->position.x && 
-        snake->body[0].y == food->position.y) {
+    Point *head = segment(snake, 0);
+    if (head->x == food->position.x && 
+        head->y == food->position.y) {
         
         // Increase score based on food type
         if (food->is_special) {
@@ -183,13 +279,14 @@ void check_food(Snake *snake, Food *food) {
             score += 1;
         }
         
-        // Grow snake
-        snake->length++;
-        snake->body = realloc(snake->body, snake->length * sizeof(Point));
-        snake->body[snake->length - 1] = snake->body[snake->length - 2];
+        // Grow snake: the tail stays put on the next move
+        snake->grow++;
         
-        // Generate new food
-        generate_food(food, snake);
+        // Generate new food; with no free cell left the board is full
+        if (!generate_food(food, snake)) {
+            game_won = 1;
+            game_over = 1;
+        }
         
         // Update high score
         if (score > high_score) {
@@ -204,108 +301,1275 @@ void check_food(Snake *snake, Food *food) {
     }
 }
 
-void game_loop() {
+void game_loop(Runtime *runtime) {
     Snake snake;
     Food food;
     
     init_snake(&snake);
-    init_food(&food);
+    init_food(&food, &snake);
     
     int ch;
-    int speed = 100000; // Initial speed (microseconds)
-    time_t last_move = time(NULL);
+    int speed = 100000; // Initial speed (microseconds per move)
+    int moved = snake.direction; // Direction of the last move, so turns queued between moves can't reverse
+    runtime_set_period(runtime, speed);
+    runtime_restart(runtime);
+    nodelay(stdscr, TRUE);
     
     while (!game_over) {
-        // Handle input
-        timeout(0); // Non-blocking input
-        ch = getch();
+        // Sleep until a key arrives or a move is due
+        int ticks = runtime_wait(runtime);
         
-        switch (ch) {
-            case KEY_UP:
-                if (snake.direction != 2) snake.direction = 0;
-                break;
-            case KEY_RIGHT:
-                if (snake.direction != 3) snake.direction = 1;
-                break;
-            case KEY_DOWN:
-                if (snake.direction != 0) snake.direction = 2;
-                break;
-            case KEY_LEFT:
-                if (snake.direction != 1) snake.direction = 3;
-                break;
-            case 'w':
-                if (snake.direction != 2) snake.direction = 0;
-                break;
-            case 'd':
-                if (snake.direction != 3) snake.direction = 1;
-                break;
-            case 's':
-                if (snake.direction != 0) snake.direction = 2;
-                break;
-            case 'a':
-                if (snake.direction != 1) snake.direction = 3;
-                break;
-            case 'q':
-                game_over = 1;
-                break;
-            case 'p':
-                // Pause game
-                while (getch() != 'p') {
-                    mvprintw(HEIGHT / 2, WIDTH / 2 - 5, "PAUSED");
-                    refresh();
-                    usleep(100000);
-                }
-                break;
+        // Handle input
+        while ((ch = getch()) != ERR) {
+            switch (ch) {
+                case KEY_UP:
+                    if (moved != 2) snake.direction = 0;
+                    break;
+                case KEY_RIGHT:
+                    if (moved != 3) snake.direction = 1;
+                    break;
+                case KEY_DOWN:
+                    if (moved != 0) snake.direction = 2;
+                    break;
+                case KEY_LEFT:
+                    if (moved != 1) snake.direction = 3;
+                    break;
+                case 'w':
+                    if (moved != 2) snake.direction = 0;
+                    break;
+                case 'd':
+                    if (moved != 3) snake.direction = 1;
+                    break;
+                case 's':
+                    if (moved != 0) snake.direction = 2;
+                    break;
+                case 'a':
+                    if (moved != 1) snake.direction = 3;
+                    break;
+                case 'q':
+                    game_over = 1;
+                    break;
+                case 'p':
+                    // Pause game, waiting for the key without spinning
+                    frame_print(HEIGHT / 2, WIDTH / 2 - 5, 0, "PAUSED");
+                    frame_present();
+                    nodelay(stdscr, FALSE);
+                    while (getch() != 'p');
+                    nodelay(stdscr, TRUE);
+                    runtime_restart(runtime); // Don't catch up on the paused time
+                    ticks = 0;
+                    break;
+            }
         }
         
-        // Game logic
-        if (difftime(time(NULL), last_move) >= 0.1) { // Move every 0.1 seconds
+        // Game logic: one move per tick
+        for (int i = 0; i < ticks && !game_over; i++) {
             update_snake(&snake);
+            moved = snake.direction;
             if (check_collision(&snake)) {
                 game_over = 1;
             }
             check_food(&snake, &food);
-            last_move = time(NULL);
             
             // Increase speed as score increases
             speed = 100000 - (score * 500);
             if (speed < 50000) speed = 50000; // Minimum speed
+            runtime_set_period(runtime, speed);
         }
         
         // Drawing
-        clear();
+        frame_begin();
         draw_borders();
         draw_snake(&snake);
         draw_food(&food);
         
         // Display score
-        mvprintw(HEIGHT + 2, 0, "Score: %d", score);
-        mvprintw(HEIGHT + 3, 0, "High Score: %d", high_score);
+        frame_print(HEIGHT + 2, 0, 0, "Score: %d", score);
+        frame_print(HEIGHT + 3, 0, 0, "High Score: %d", high_score);
         if (special_active) {
             int time_left = 10 - difftime(time(NULL), food.spawn_time);
-            mvprintw(HEIGHT + 4, 0, "Special Food: %d seconds left", time_left);
+            frame_print(HEIGHT + 4, 0, 0, "Special Food: %d seconds left", time_left);
         }
         
-        refresh();
-        usleep(speed);
+        frame_present();
     }
     
-    free(snake.body);
+    nodelay(stdscr, FALSE);
+    free_snake(&snake);
 }
 
 void show_game_over() {
-    clear();
-    mvprintw(HEIGHT / 2 - 1, WIDTH / 2 - 5, "GAME OVER");
-    mvprintw(HEIGHT / 2, WIDTH / 2 - 8, "Final Score: %d", score);
-    mvprintw(HEIGHT / 2 + 1, WIDTH / 2 - 10, "High Score: %d", high_score);
-    mvprintw(HEIGHT / 2 + 3, WIDTH / 2 - 12, "Press any key to exit");
-    refresh();
+    frame_begin();
+    if (game_won) {
+        frame_print(HEIGHT / 2 - 1, WIDTH / 2 - 9, 0, "YOU WIN - BOARD FULL");
+    } else {
+        frame_print(HEIGHT / 2 - 1, WIDTH / 2 - 5, 0, "GAME OVER");
+    }
+    frame_print(HEIGHT / 2, WIDTH / 2 - 8, 0, "Final Score: %d", score);
+    frame_print(HEIGHT / 2 + 1, WIDTH / 2 - 10, 0, "High Score: %d", high_score);
+    frame_print(HEIGHT / 2 + 3, WIDTH / 2 - 12, 0, "Press any key to exit");
+    frame_present();
     getch();
 }
 
-int main() {
+double seconds_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Autopilot: the snake follows a Hamiltonian cycle over the board and takes
+// A* shortcuts towards the food only when they keep its body inside the
+// stretch of cycle between tail and head. Following the cycle is then
+// always safe, so it is the fallback whenever no safe shortcut is found.
+typedef struct {
+    long key;
+    int cell;
+} HeapEntry;
+
+typedef struct {
+    int cells;
+    int *order;       // Position of each cell on the cycle
+    int *cycle;       // Cell at each position of the cycle
+    // A* scratch space, reused between searches
+    int *parent;
+    int *cost;
+    int *seen;        // Search stamp of the last search that reached each cell
+    int stamp;
+    HeapEntry *heap;
+    int heap_size;
+    // Planned path to the food, head excluded
+    int *path;
+    int path_length;
+    int path_pos;
+    int target;       // Food cell the path leads to, -1 if none
+    int failed_target; // Food cell the last search gave up on
+    // Statistics
+    long searches;
+    long nodes;
+    long shortcuts;   // Moves taken off the cycle
+} Autopilot;
+
+int cycle_cell(int x, int y, int transpose) {
+    return transpose ? x * board_width + y : y * board_width + x;
+}
+
+// Lay a Hamiltonian cycle over the board: down the first column, then up
+// and down the other columns below row 0, and back along row 0. Needs an
+// even width, or an even height with rows and columns swapped.
+int build_cycle(Autopilot *pilot) {
+    int transpose = board_width % 2 != 0;
+    int w = transpose ? board_height : board_width;
+    int h = transpose ? board_width : board_height;
+    if (w % 2 != 0 || h < 2) {
+        return 0;
+    }
+    int n = 0;
+    for (int y = 0; y < h; y++) {
+        pilot->cycle[n++] = cycle_cell(0, y, transpose);
+    }
+    for (int x = 1; x < w; x++) {
+        for (int i = 1; i < h; i++) {
+            int y = x % 2 ? h - i : i;
+            pilot->cycle[n++] = cycle_cell(x, y, transpose);
+        }
+    }
+    for (int x = w - 1; x > 0; x--) {
+        pilot->cycle[n++] = cycle_cell(x, 0, transpose);
+    }
+    for (int i = 0; i < n; i++) {
+        pilot->order[pilot->cycle[i]] = i;
+    }
+    return 1;
+}
+
+int init_autopilot(Autopilot *pilot) {
+    memset(pilot, 0, sizeof(*pilot));
+    pilot->cells = board_width * board_height;
+    pilot->order = malloc(pilot->cells * sizeof(int));
+    pilot->cycle = malloc(pilot->cells * sizeof(int));
+    pilot->parent = malloc(pilot->cells * sizeof(int));
+    pilot->cost = malloc(pilot->cells * sizeof(int));
+    pilot->seen = calloc(pilot->cells, sizeof(int));
+    pilot->heap = malloc(pilot->cells * sizeof(HeapEntry));
+    pilot->path = malloc(pilot->cells * sizeof(int));
+    pilot->target = -1;
+    pilot->failed_target = -1;
+    return build_cycle(pilot);
+}
+
+void free_autopilot(Autopilot *pilot) {
+    free(pilot->order);
+    free(pilot->cycle);
+    free(pilot->parent);
+    free(pilot->cost);
+    free(pilot->seen);
+    free(pilot->heap);
+    free(pilot->path);
+}
+
+// Distance from cell a forward along the cycle to cell b
+int cycle_distance(Autopilot *pilot, int a, int b) {
+    int d = pilot->order[b] - pilot->order[a];
+    return d < 0 ? d + pilot->cells : d;
+}
+
+// Whether moving the head to cell next (one of its neighbours) keeps every
+// later move along the cycle safe: next must lie ahead of the head and
+// leave enough free cycle before the tail for the pending growth
+int safe_shortcut(Autopilot *pilot, Snake *snake, int head, int tail, int next, int food) {
+    int grow = snake->grow + (next == food);
+    return !snake->occupied[next] &&
+           cycle_distance(pilot, head, next) + grow < cycle_distance(pilot, head, tail);
+}
+
+void heap_push(Autopilot *pilot, long key, int cell) {
+    int i = pilot->heap_size++;
+    while (i > 0 && pilot->heap[(i - 1) / 2].key > key) {
+        pilot->heap[i] = pilot->heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    pilot->heap[i].key = key;
+    pilot->heap[i].cell = cell;
+}
+
+int heap_pop(Autopilot *pilot) {
+    int cell = pilot->heap[0].cell;
+    HeapEntry last = pilot->heap[--pilot->heap_size];
+    int i = 0;
+    while (2 * i + 1 < pilot->heap_size) {
+        int child = 2 * i + 1;
+        if (child + 1 < pilot->heap_size && pilot->heap[child + 1].key < pilot->heap[child].key) {
+            child++;
+        }
+        if (last.key <= pilot->heap[child].key) {
+            break;
+        }
+        pilot->heap[i] = pilot->heap[child];
+        i = child;
+    }
+    pilot->heap[i] = last;
+    return cell;
+}
+
+// Cells next to cell, -1 where the board ends
+void neighbours(int cell, int out[4]) {
+    int x = cell % board_width;
+    int y = cell / board_width;
+    out[0] = y > 0 ? cell - board_width : -1;
+    out[1] = x < board_width - 1 ? cell + 1 : -1;
+    out[2] = y < board_height - 1 ? cell + board_width : -1;
+    out[3] = x > 0 ? cell - 1 : -1;
+}
+
+// A* from the head to the food through cells that move forward along the
+// cycle and stay clear of the tail, so every step of the path is a safe
+// shortcut. Gives up after a node budget proportional to the distance.
+// Returns 1 and fills pilot->path on success.
+int plan_path(Autopilot *pilot, Snake *snake, int head, int tail, int food) {
+    pilot->searches++;
+    pilot->stamp++;
+    pilot->heap_size = 0;
+    pilot->path_length = 0;
+    pilot->path_pos = 0;
+
+    int fx = food % board_width;
+    int fy = food / board_width;
+    int food_distance = cycle_distance(pilot, head, food);
+    int tail_distance = cycle_distance(pilot, head, tail);
+    if (food_distance + snake->grow + 1 >= tail_distance) {
+        return 0; // Food is behind the tail on the cycle
+    }
+    int start_distance = abs(head % board_width - fx) + abs(head / board_width - fy);
+    long budget = AUTOPILOT_NODES_PER_STEP * (long)start_distance + AUTOPILOT_MIN_NODES;
+
+    pilot->seen[head] = pilot->stamp;
+    pilot->cost[head] = 0;
+    heap_push(pilot, start_distance, head);
+    while (pilot->heap_size > 0 && budget-- > 0) {
+        int cell = heap_pop(pilot);
+        pilot->nodes++;
+        if (cell == food) {
+            for (int c = food; c != head; c = pilot->parent[c]) {
+                pilot->path[pilot->path_length++] = c;
+            }
+            // Stored food first; steps are taken from the end
+            pilot->path_pos = pilot->path_length;
+            return 1;
+        }
+        int ahead = cycle_distance(pilot, head, cell);
+        int next[4];
+        neighbours(cell, next);
+        for (int i = 0; i < 4; i++) {
+            int n = next[i];
+            if (n < 0 || pilot->seen[n] == pilot->stamp || snake->occupied[n]) {
+                continue;
+            }
+            int distance = cycle_distance(pilot, head, n);
+            if (distance <= ahead || distance > food_distance) {
+                continue;
+            }
+            pilot->seen[n] = pilot->stamp;
+            pilot->parent[n] = cell;
+            pilot->cost[n] = pilot->cost[cell] + 1;
+            int estimate = abs(n % board_width - fx) + abs(n / board_width - fy);
+            // Break ties towards longer paths, i.e. nearer the food
+            long f = pilot->cost[n] + estimate;
+            heap_push(pilot, f * pilot->cells - pilot->cost[n], n);
+        }
+    }
+    return 0;
+}
+
+// Choose the next cell for the head
+int autopilot_move(Autopilot *pilot, Snake *snake, Food *food) {
+    Point *h = segment(snake, 0);
+    Point *t = segment(snake, snake->length - 1);
+    int head = h->y * board_width + h->x;
+    int tail = t->y * board_width + t->x;
+    int target = food->position.y * board_width + food->position.x;
+    // Shortcuts leave gaps in the body's stretch of cycle; stop taking
+    // them once the board is half full so the gaps close before the end
+    int shortcuts = snake->length < pilot->cells / 2;
+
+    if (shortcuts && pilot->target != target && pilot->failed_target != target) {
+        pilot->target = target;
+        if (!plan_path(pilot, snake, head, tail, target)) {
+            pilot->failed_target = target;
+            pilot->target = -1;
+        }
+    }
+    if (shortcuts && pilot->target == target && pilot->path_pos > 0) {
+        int next = pilot->path[--pilot->path_pos];
+        if (!snake->occupied[next]) {
+            pilot->shortcuts += cycle_distance(pilot, head, next) > 1;
+            return next;
+        }
+        pilot->target = -1;
+    }
+
+    // No planned path: take the neighbour nearest the food along the cycle,
+    // which is the next cycle cell unless a safe shortcut beats it
+    int best = pilot->cycle[(pilot->order[head] + 1) % pilot->cells];
+    if (shortcuts) {
+        int next[4];
+        neighbours(head, next);
+        for (int i = 0; i < 4; i++) {
+            if (next[i] >= 0 && safe_shortcut(pilot, snake, head, tail, next[i], target) &&
+                cycle_distance(pilot, next[i], target) < cycle_distance(pilot, best, target)) {
+                best = next[i];
+            }
+        }
+        pilot->shortcuts += best != pilot->cycle[(pilot->order[head] + 1) % pilot->cells];
+    }
+    return best;
+}
+
+void steer_towards(Snake *snake, int cell) {
+    Point *head = segment(snake, 0);
+    int x = cell % board_width;
+    int y = cell / board_width;
+    if (y < head->y) snake->direction = 0;
+    else if (x > head->x) snake->direction = 1;
+    else if (y > head->y) snake->direction = 2;
+    else snake->direction = 3;
+}
+
+typedef struct {
+    int games;
+    int completed;
+    long moves;
+    double fill_total;   // Sum of the final fraction of the board covered
+    double seconds;
+    long searches;
+    long nodes;
+    long shortcuts;
+} AutopilotResult;
+
+// Play headless games with the autopilot, without a frame or tick limit
+AutopilotResult run_autopilot(int games, long max_moves, unsigned int seed) {
+    AutopilotResult result = {0};
+    wrap_around = 0;
+    special_food = 0;
+
+    for (int game = 0; game < games; game++) {
+        Autopilot pilot;
+        if (!init_autopilot(&pilot)) {
+            free_autopilot(&pilot);
+            break;
+        }
+        Snake snake;
+        Food food;
+        srand(seed + game);
+        game_over = 0;
+        game_won = 0;
+        score = 0;
+        special_active = 0;
+        init_snake(&snake);
+        init_food(&food, &snake);
+
+        double start = seconds_now();
+        long moves = 0;
+        while (!game_over && moves < max_moves) {
+            steer_towards(&snake, autopilot_move(&pilot, &snake, &food));
+            update_snake(&snake);
+            if (check_collision(&snake)) {
+                game_over = 1;
+            }
+            check_food(&snake, &food);
+            moves++;
+        }
+        result.seconds += seconds_now() - start;
+
+        result.games++;
+        result.completed += game_won;
+        result.moves += moves;
+        result.fill_total += (double)snake.length / pilot.cells;
+        result.searches += pilot.searches;
+        result.nodes += pilot.nodes;
+        result.shortcuts += pilot.shortcuts;
+        free_snake(&snake);
+        free_autopilot(&pilot);
+    }
+    return result;
+}
+
+void print_autopilot_result(AutopilotResult result) {
+    if (result.games == 0) {
+        printf("%5d x %-5d needs an even width or height for the autopilot\n",
+               board_width, board_height);
+        return;
+    }
+    printf("%5d x %-5d games %d  completed %d (%.0f%%)  avg fill %.1f%%  moves %ld  "
+           "%.2f M moves/sec  %.0f ns/move  searches %ld (%.0f nodes avg)  shortcuts %ld\n",
+           board_width, board_height, result.games, result.completed,
+           100.0 * result.completed / result.games, 100.0 * result.fill_total / result.games,
+           result.moves, result.moves / result.seconds / 1e6, result.seconds * 1e9 / result.moves,
+           result.searches, result.searches ? (double)result.nodes / result.searches : 0.0,
+           result.shortcuts);
+}
+
+// Run the autopilot on one board size, or on a range of sizes
+void run_autopilot_mode(int width, int height, int games, long max_moves, unsigned int seed) {
+    if (width > 0) {
+        board_width = width;
+        board_height = height;
+        print_autopilot_result(run_autopilot(games, max_moves, seed));
+        return;
+    }
+    const int sizes[][3] = { {30, 20, 10}, {64, 64, 4}, {128, 128, 2}, {1024, 1024, 1} };
+    for (int i = 0; i < 4; i++) {
+        board_width = sizes[i][0];
+        board_height = sizes[i][1];
+        print_autopilot_result(run_autopilot(games > 0 ? games : sizes[i][2], max_moves, seed));
+    }
+}
+
+// Batched environments: many independent games advanced together by one
+// step_batch call, for bulk policy evaluation. Per-game state is kept as
+// structure-of-arrays; each game's body ring, occupancy grid and free-cell
+// list live in its own block of shared arrays. The rules follow
+// update_snake, check_collision and check_food, with special food expiring
+// after a number of steps instead of by wall clock. Finished games are
+// reset automatically from their own random stream, so results do not
+// depend on how the games are split across threads.
+typedef struct {
+    int count;
+    int width;
+    int height;
+    int cells;
+    int ring_capacity;     // Power of two >= cells
+    // Per-environment state
+    int *head;             // Cell of the head
+    int *ring_head;        // Index of the head in the body ring
+    int *direction;
+    int *length;
+    int *grow;
+    int *food;             // Cell of the food
+    unsigned char *special;
+    int *food_age;         // Steps since the food appeared
+    int *score;
+    unsigned int *rng;
+    int *free_count;
+    // Step results
+    int *reward;           // Points scored this step
+    unsigned char *done;   // The game ended this step and was reset
+    unsigned char *won;    // ...by filling the board
+    long *episodes;
+    long *score_total;     // Over finished episodes
+    // Per-environment blocks
+    int *bodies;           // ring_capacity cells each
+    unsigned char *occupied; // cells each
+    int *free_cells;       // cells each
+    int *free_index;       // cells each
+    const int *actions;    // Actions for the step in progress
+} SnakeBatch;
+
+unsigned int next_random(unsigned int *state) {
+    unsigned int z = (*state += 0x9E3779B9u);
+    z = (z ^ (z >> 16)) * 0x85EBCA6Bu;
+    z = (z ^ (z >> 13)) * 0xC2B2AE35u;
+    return z ^ (z >> 16);
+}
+
+void batch_claim(SnakeBatch *batch, int env, int cell) {
+    int *free_cells = batch->free_cells + (size_t)env * batch->cells;
+    int *free_index = batch->free_index + (size_t)env * batch->cells;
+    int index = free_index[cell];
+    int last = free_cells[--batch->free_count[env]];
+    free_cells[index] = last;
+    free_index[last] = index;
+    free_index[cell] = -1;
+    batch->occupied[(size_t)env * batch->cells + cell] = 1;
+}
+
+void batch_release(SnakeBatch *batch, int env, int cell) {
+    int *free_cells = batch->free_cells + (size_t)env * batch->cells;
+    int *free_index = batch->free_index + (size_t)env * batch->cells;
+    free_index[cell] = batch->free_count[env];
+    free_cells[batch->free_count[env]++] = cell;
+    batch->occupied[(size_t)env * batch->cells + cell] = 0;
+}
+
+// Place new food like generate_food. Returns 0 if the board is full.
+int batch_place_food(SnakeBatch *batch, int env) {
+    if (batch->free_count[env] == 0) {
+        return 0;
+    }
+    const int *free_cells = batch->free_cells + (size_t)env * batch->cells;
+    batch->food[env] = free_cells[next_random(&batch->rng[env]) % batch->free_count[env]];
+    batch->special[env] = special_food && next_random(&batch->rng[env]) % 5 == 0;
+    batch->food_age[env] = 0;
+    return 1;
+}
+
+// Start a new game in env. Only the old body is released, so a reset
+// costs O(length) rather than O(cells).
+void reset_env(SnakeBatch *batch, int env) {
+    int *ring = batch->bodies + (size_t)env * batch->ring_capacity;
+    int mask = batch->ring_capacity - 1;
+    for (int i = 0; i < batch->length[env]; i++) {
+        batch_release(batch, env, ring[(batch->ring_head[env] - i) & mask]);
+    }
+
+    int y = batch->height / 2;
+    for (int i = 0; i < INITIAL_LENGTH; i++) {
+        ring[i] = y * batch->width + batch->width / 2 - (INITIAL_LENGTH - 1 - i);
+        batch_claim(batch, env, ring[i]);
+    }
+    batch->ring_head[env] = INITIAL_LENGTH - 1;
+    batch->head[env] = ring[INITIAL_LENGTH - 1];
+    batch->length[env] = INITIAL_LENGTH;
+    batch->grow[env] = 0;
+    batch->direction[env] = 1;
+    batch->score[env] = 0;
+    batch_place_food(batch, env);
+}
+
+void init_batch(SnakeBatch *batch, int count, unsigned int seed) {
+    memset(batch, 0, sizeof(*batch));
+    batch->count = count;
+    batch->width = board_width;
+    batch->height = board_height;
+    batch->cells = board_width * board_height;
+    batch->ring_capacity = 1;
+    while (batch->ring_capacity < batch->cells) {
+        batch->ring_capacity *= 2;
+    }
+
+    batch->head = malloc(count * sizeof(int));
+    batch->ring_head = malloc(count * sizeof(int));
+    batch->direction = malloc(count * sizeof(int));
+    batch->length = calloc(count, sizeof(int));
+    batch->grow = malloc(count * sizeof(int));
+    batch->food = malloc(count * sizeof(int));
+    batch->special = malloc(count);
+    batch->food_age = malloc(count * sizeof(int));
+    batch->score = malloc(count * sizeof(int));
+    batch->rng = malloc(count * sizeof(unsigned int));
+    batch->free_count = malloc(count * sizeof(int));
+    batch->reward = calloc(count, sizeof(int));
+    batch->done = calloc(count, 1);
+    batch->won = calloc(count, 1);
+    batch->episodes = calloc(count, sizeof(long));
+    batch->score_total = calloc(count, sizeof(long));
+    batch->bodies = malloc((size_t)count * batch->ring_capacity * sizeof(int));
+    batch->occupied = calloc((size_t)count * batch->cells, 1);
+    batch->free_cells = malloc((size_t)count * batch->cells * sizeof(int));
+    batch->free_index = malloc((size_t)count * batch->cells * sizeof(int));
+
+    for (int env = 0; env < count; env++) {
+        int *free_cells = batch->free_cells + (size_t)env * batch->cells;
+        int *free_index = batch->free_index + (size_t)env * batch->cells;
+        for (int i = 0; i < batch->cells; i++) {
+            free_cells[i] = i;
+            free_index[i] = i;
+        }
+        batch->free_count[env] = batch->cells;
+        unsigned int state = seed + env;
+        batch->rng[env] = next_random(&state);
+        reset_env(batch, env);
+    }
+}
+
+void free_batch(SnakeBatch *batch) {
+    free(batch->head);
+    free(batch->ring_head);
+    free(batch->direction);
+    free(batch->length);
+    free(batch->grow);
+    free(batch->food);
+    free(batch->special);
+    free(batch->food_age);
+    free(batch->score);
+    free(batch->rng);
+    free(batch->free_count);
+    free(batch->reward);
+    free(batch->done);
+    free(batch->won);
+    free(batch->episodes);
+    free(batch->score_total);
+    free(batch->bodies);
+    free(batch->occupied);
+    free(batch->free_cells);
+    free(batch->free_index);
+}
+
+// Advance one game by one move. action is a direction (0-3) as in the
+// key handling, or -1 to keep going straight.
+void step_env(SnakeBatch *batch, int env, int action) {
+    int *ring = batch->bodies + (size_t)env * batch->ring_capacity;
+    int mask = batch->ring_capacity - 1;
+    int width = batch->width;
+    batch->reward[env] = 0;
+    batch->done[env] = 0;
+    batch->won[env] = 0;
+
+    if (action >= 0 && action < 4 && action != (batch->direction[env] + 2) % 4) {
+        batch->direction[env] = action;
+    }
+
+    int x = batch->head[env] % width;
+    int y = batch->head[env] / width;
+    switch (batch->direction[env]) {
+        case 0: y--; break;
+        case 1: x++; break;
+        case 2: y++; break;
+        case 3: x--; break;
+    }
+    int dead = 0;
+    if (wrap_around) {
+        if (x >= width) x = 0;
+        if (x < 0) x = width - 1;
+        if (y >= batch->height) y = 0;
+        if (y < 0) y = batch->height - 1;
+    } else if (x < 0 || x >= width || y < 0 || y >= batch->height) {
+        dead = 1;
+    }
+
+    int cell = y * width + x;
+    int tail = ring[(batch->ring_head[env] - batch->length[env] + 1) & mask];
+    if (!dead) {
+        // The tail moves out of the way unless the snake is growing
+        int tail_leaves = batch->grow[env] == 0 && cell == tail;
+        dead = batch->occupied[(size_t)env * batch->cells + cell] && !tail_leaves;
+    }
+
+    if (!dead) {
+        if (batch->grow[env] > 0) {
+            batch->grow[env]--;
+            batch->length[env]++;
+        } else {
+            batch_release(batch, env, tail);
+        }
+        batch_claim(batch, env, cell);
+        batch->ring_head[env] = (batch->ring_head[env] + 1) & mask;
+        ring[batch->ring_head[env]] = cell;
+        batch->head[env] = cell;
+
+        if (cell == batch->food[env]) {
+            int points = batch->special[env] ? 5 : 1;
+            batch->score[env] += points;
+            batch->reward[env] = points;
+            batch->grow[env]++;
+            if (!batch_place_food(batch, env)) {
+                batch->won[env] = 1;
+                dead = 1;
+            }
+        } else if (batch->special[env] && ++batch->food_age[env] > SPECIAL_FOOD_STEPS) {
+            batch_place_food(batch, env);
+        }
+    }
+
+    if (dead) {
+        batch->done[env] = 1;
+        batch->episodes[env]++;
+        batch->score_total[env] += batch->score[env];
+        reset_env(batch, env);
+    }
+}
+
+void step_chunk(void *context, int chunk) {
+    SnakeBatch *batch = context;
+    int first = chunk * BATCH_CHUNK;
+    int last = first + BATCH_CHUNK < batch->count ? first + BATCH_CHUNK : batch->count;
+    for (int env = first; env < last; env++) {
+        step_env(batch, env, batch->actions[env]);
+    }
+}
+
+// Advance every game by one move with actions[env], across the pool
+void step_batch(SnakeBatch *batch, const int *actions, ThreadPool *pool) {
+    batch->actions = actions;
+    run_pool(pool, (batch->count + BATCH_CHUNK - 1) / BATCH_CHUNK, step_chunk, batch);
+}
+
+// Benchmark policy: turn towards the food when that is not a reversal
+int chase_food(const SnakeBatch *batch, int env) {
+    int dx = batch->food[env] % batch->width - batch->head[env] % batch->width;
+    int dy = batch->food[env] / batch->width - batch->head[env] / batch->width;
+    int want = dx > 0 ? 1 : dx < 0 ? 3 : dy > 0 ? 2 : 0;
+    if (want == (batch->direction[env] + 2) % 4) {
+        want = dy > 0 ? 2 : 0;
+    }
+    return want;
+}
+
+typedef struct {
+    const SnakeBatch *batch;
+    int *actions;
+} BatchPolicy;
+
+void fill_actions(void *context, int chunk) {
+    BatchPolicy *policy = context;
+    const SnakeBatch *batch = policy->batch;
+    int first = chunk * BATCH_CHUNK;
+    int last = first + BATCH_CHUNK < batch->count ? first + BATCH_CHUNK : batch->count;
+    for (int env = first; env < last; env++) {
+        policy->actions[env] = chase_food(batch, env);
+    }
+}
+
+typedef struct {
+    double seconds;
+    long episodes;
+    long score_total;
+    uint64_t checksum;
+} BatchResult;
+
+BatchResult run_batch(int env_count, int thread_count, long steps, unsigned int seed) {
+    BatchResult result = {0};
+    SnakeBatch batch;
+    ThreadPool pool;
+    wrap_around = 0;
+    special_food = 1;
+    init_batch(&batch, env_count, seed);
+    init_pool(&pool, thread_count);
+    int *actions = malloc(env_count * sizeof(int));
+    BatchPolicy policy = { &batch, actions };
+    int chunks = (env_count + BATCH_CHUNK - 1) / BATCH_CHUNK;
+
+    double start = seconds_now();
+    for (long step = 0; step < steps; step++) {
+        run_pool(&pool, chunks, fill_actions, &policy);
+        step_batch(&batch, actions, &pool);
+    }
+    result.seconds = seconds_now() - start;
+
+    result.checksum = 0xCBF29CE484222325ull;
+    for (int env = 0; env < env_count; env++) {
+        result.episodes += batch.episodes[env];
+        result.score_total += batch.score_total[env];
+        uint64_t state = ((uint64_t)batch.head[env] << 32) ^ batch.food[env] ^
+                         ((uint64_t)batch.length[env] << 20) ^ (uint64_t)batch.score_total[env];
+        result.checksum = (result.checksum ^ state) * 0x100000001B3ull;
+    }
+    free(actions);
+    destroy_pool(&pool);
+    free_batch(&batch);
+    return result;
+}
+
+void print_batch_result(int env_count, int thread_count, long steps, BatchResult result) {
+    printf("%5d x %-4d envs %6d  threads %2d  steps %ld  %7.2f M env-steps/sec  "
+           "episodes %ld  mean score %.1f  checksum %016llx\n",
+           board_width, board_height, env_count, thread_count, steps,
+           env_count * (double)steps / result.seconds / 1e6, result.episodes,
+           result.episodes ? (double)result.score_total / result.episodes : 0.0,
+           (unsigned long long)result.checksum);
+}
+
+// Run one batch, or a sweep over thread counts to show scaling
+void run_batch_mode(int env_count, int thread_count, long steps, unsigned int seed) {
+    if (thread_count > 0) {
+        print_batch_result(env_count, thread_count, steps,
+                           run_batch(env_count, thread_count, steps, seed));
+        return;
+    }
+    int cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    for (int threads = 1; ; threads *= 2) {
+        if (threads > cores) threads = cores;
+        print_batch_result(env_count, threads, steps, run_batch(env_count, threads, steps, seed));
+        if (threads == cores) break;
+    }
+}
+
+// Arena: many snakes and food items on one shared board. A tick runs in
+// three parallel passes over the snakes, each reading only what the
+// previous pass finished writing:
+//   decide  - pick a direction from the shared grid and claim the target
+//             cell; the claim keeps the minimum key, so the winner of a
+//             contested cell does not depend on thread timing
+//   resolve - a snake dies if it leaves the board, loses its claim or
+//             runs into a cell that was occupied when the tick began
+//   apply   - survivors move (every target is a distinct cell that was
+//             empty) and the dead release their bodies
+// Food and dead snakes are then respawned on one thread in snake order.
+#define ARENA_NO_CLAIM 0xFFFFFFFFu
+
+typedef struct {
+    int *body;          // Ring of cells, head at body[head]
+    int capacity;       // Power of two
+    int head;
+    int length;
+    int grow;
+    int direction;
+    int alive;
+    int target;         // Cell the head moves to this tick, -1 off the board
+    unsigned int key;   // Claim priority: longer snakes, then lower ids, win
+    int dies;
+    int eats;
+    long food_eaten;
+    int deaths;
+} ArenaSnake;
+
+typedef struct {
+    int width;
+    int height;
+    int snake_count;
+    int food_count;
+    ArenaSnake *snakes;
+    unsigned char *occupied;
+    unsigned char *has_food;
+    int *foods;         // Cell of each food item, -1 while waiting to respawn
+    atomic_uint *claims;
+    unsigned int rng;
+    long ticks;
+    long contests_lost; // Snakes killed by losing a contested cell
+    long failed_spawns; // Spawn attempts that found no free run of cells
+} Arena;
+
+// Free cell with no food on it, or -1 if random probing found none
+int arena_random_cell(Arena *arena) {
+    for (int i = 0; i < ARENA_SPAWN_TRIES; i++) {
+        int cell = next_random(&arena->rng) % (arena->width * arena->height);
+        if (!arena->occupied[cell] && !arena->has_food[cell]) {
+            return cell;
+        }
+    }
+    return -1;
+}
+
+// Place a snake on INITIAL_LENGTH free cells in a row, heading right. On a
+// crowded board this can fail; the snake stays dead and is retried on the
+// next tick.
+void arena_spawn_snake(Arena *arena, ArenaSnake *snake) {
+    for (int i = 0; i < ARENA_SPAWN_TRIES; i++) {
+        int cell = arena_random_cell(arena);
+        if (cell < 0) {
+            break;
+        }
+        int x = cell % arena->width;
+        if (x + INITIAL_LENGTH >= arena->width) {
+            continue;
+        }
+        int clear = 1;
+        for (int j = 1; j < INITIAL_LENGTH; j++) {
+            clear &= !arena->occupied[cell + j] && !arena->has_food[cell + j];
+        }
+        if (!clear) {
+            continue;
+        }
+        for (int j = 0; j < INITIAL_LENGTH; j++) {
+            snake->body[j] = cell + j;
+            arena->occupied[cell + j] = 1;
+        }
+        snake->head = INITIAL_LENGTH - 1;
+        snake->length = INITIAL_LENGTH;
+        snake->grow = 0;
+        snake->direction = 1;
+        snake->alive = 1;
+        return;
+    }
+    arena->failed_spawns++;
+}
+
+void init_arena(Arena *arena, int snake_count, int width, int height, unsigned int seed) {
+    int cells = width * height;
+    arena->width = width;
+    arena->height = height;
+    arena->snake_count = snake_count;
+    arena->food_count = snake_count * ARENA_FOOD_PER_SNAKE;
+    arena->snakes = calloc(snake_count, sizeof(ArenaSnake));
+    arena->occupied = calloc(cells, 1);
+    arena->has_food = calloc(cells, 1);
+    arena->foods = malloc(arena->food_count * sizeof(int));
+    arena->claims = malloc(cells * sizeof(atomic_uint));
+    for (int i = 0; i < cells; i++) {
+        atomic_init(&arena->claims[i], ARENA_NO_CLAIM);
+    }
+    arena->rng = seed;
+    arena->ticks = 0;
+    arena->contests_lost = 0;
+    arena->failed_spawns = 0;
+
+    for (int i = 0; i < snake_count; i++) {
+        arena->snakes[i].capacity = 16;
+        arena->snakes[i].body = calloc(16, sizeof(int));
+        arena_spawn_snake(arena, &arena->snakes[i]);
+    }
+    for (int i = 0; i < arena->food_count; i++) {
+        arena->foods[i] = arena_random_cell(arena);
+        if (arena->foods[i] >= 0) {
+            arena->has_food[arena->foods[i]] = 1;
+        }
+    }
+}
+
+void free_arena(Arena *arena) {
+    for (int i = 0; i < arena->snake_count; i++) {
+        free(arena->snakes[i].body);
+    }
+    free(arena->snakes);
+    free(arena->occupied);
+    free(arena->has_food);
+    free(arena->foods);
+    free(arena->claims);
+}
+
+// Cell one step from cell in direction, or -1 off the board
+int arena_step(const Arena *arena, int cell, int direction) {
+    int x = cell % arena->width;
+    int y = cell / arena->width;
+    switch (direction) {
+        case 0: y--; break;
+        case 1: x++; break;
+        case 2: y++; break;
+        case 3: x--; break;
+    }
+    if (x < 0 || x >= arena->width || y < 0 || y >= arena->height) {
+        return -1;
+    }
+    return y * arena->width + x;
+}
+
+// Scripted AI: head for this snake's food item, over free cells only
+void arena_decide(void *context, int chunk) {
+    Arena *arena = context;
+    int first = chunk * ARENA_CHUNK;
+    int last = first + ARENA_CHUNK < arena->snake_count ? first + ARENA_CHUNK : arena->snake_count;
+
+    for (int id = first; id < last; id++) {
+        ArenaSnake *snake = &arena->snakes[id];
+        snake->target = -1;
+        if (!snake->alive) {
+            continue;
+        }
+        int head = snake->body[snake->head];
+        int food = arena->foods[id % arena->food_count];
+        int best = -1;
+        int best_distance = 0;
+        for (int turn = 0; turn < 3; turn++) {
+            // Straight first, so ties keep the current direction
+            int direction = (snake->direction + (turn == 0 ? 0 : turn == 1 ? 1 : 3)) % 4;
+            int cell = arena_step(arena, head, direction);
+            if (cell < 0 || arena->occupied[cell]) {
+                continue;
+            }
+            int distance = 0;
+            if (food >= 0) {
+                distance = abs(cell % arena->width - food % arena->width) +
+                           abs(cell / arena->width - food / arena->width);
+            }
+            if (best < 0 || distance < best_distance) {
+                best = direction;
+                best_distance = distance;
+            }
+        }
+        if (best >= 0) {
+            snake->direction = best;
+        }
+        snake->target = arena_step(arena, head, snake->direction);
+
+        int priority = snake->length < 4095 ? snake->length : 4095;
+        snake->key = (unsigned int)(4095 - priority) << 20 | (unsigned int)id;
+        if (snake->target >= 0) {
+            atomic_uint *claim = &arena->claims[snake->target];
+            unsigned int current = atomic_load(claim);
+            while (snake->key < current &&
+                   !atomic_compare_exchange_weak(claim, &current, snake->key));
+        }
+    }
+}
+
+void arena_resolve(void *context, int chunk) {
+    Arena *arena = context;
+    int first = chunk * ARENA_CHUNK;
+    int last = first + ARENA_CHUNK < arena->snake_count ? first + ARENA_CHUNK : arena->snake_count;
+
+    for (int id = first; id < last; id++) {
+        ArenaSnake *snake = &arena->snakes[id];
+        snake->dies = 0;
+        snake->eats = 0;
+        if (!snake->alive) {
+            continue;
+        }
+        int target = snake->target;
+        if (target < 0 || arena->occupied[target]) {
+            snake->dies = 1;
+        } else if (atomic_load(&arena->claims[target]) != snake->key) {
+            snake->dies = 2; // Lost a head-on contest
+        } else {
+            snake->eats = arena->has_food[target];
+        }
+    }
+}
+
+void arena_apply(void *context, int chunk) {
+    Arena *arena = context;
+    int first = chunk * ARENA_CHUNK;
+    int last = first + ARENA_CHUNK < arena->snake_count ? first + ARENA_CHUNK : arena->snake_count;
+
+    for (int id = first; id < last; id++) {
+        ArenaSnake *snake = &arena->snakes[id];
+        if (!snake->alive) {
+            continue;
+        }
+        int mask = snake->capacity - 1;
+        if (snake->target >= 0) {
+            atomic_store(&arena->claims[snake->target], ARENA_NO_CLAIM);
+        }
+        if (snake->dies) {
+            for (int i = 0; i < snake->length; i++) {
+                arena->occupied[snake->body[(snake->head - i) & mask]] = 0;
+            }
+            snake->alive = 0;
+            snake->deaths++;
+            continue;
+        }
+
+        if (snake->eats) {
+            arena->has_food[snake->target] = 0;
+            snake->grow++;
+            snake->food_eaten++;
+        }
+        if (snake->grow > 0) {
+            snake->grow--;
+            if (snake->length == snake->capacity) {
+                // Double the ring, unwrapping it so the tail sits at index 0
+                int *body = malloc(snake->capacity * 2 * sizeof(int));
+                for (int i = 0; i < snake->length; i++) {
+                    body[i] = snake->body[(snake->head - snake->length + 1 + i) & mask];
+                }
+                free(snake->body);
+                snake->body = body;
+                snake->capacity *= 2;
+                snake->head = snake->length - 1;
+                mask = snake->capacity - 1;
+            }
+            snake->length++;
+        } else {
+            arena->occupied[snake->body[(snake->head - snake->length + 1) & mask]] = 0;
+        }
+        snake->head = (snake->head + 1) & mask;
+        snake->body[snake->head] = snake->target;
+        arena->occupied[snake->target] = 1;
+    }
+}
+
+// One tick of the arena on the pool
+void step_arena(Arena *arena, ThreadPool *pool) {
+    int chunks = (arena->snake_count + ARENA_CHUNK - 1) / ARENA_CHUNK;
+    run_pool(pool, chunks, arena_decide, arena);
+    run_pool(pool, chunks, arena_resolve, arena);
+    for (int id = 0; id < arena->snake_count; id++) {
+        arena->contests_lost += arena->snakes[id].alive && arena->snakes[id].dies == 2;
+    }
+    run_pool(pool, chunks, arena_apply, arena);
+
+    // Serial, in a fixed order: replace eaten food and revive dead snakes
+    for (int i = 0; i < arena->food_count; i++) {
+        if (arena->foods[i] < 0 || !arena->has_food[arena->foods[i]]) {
+            arena->foods[i] = arena_random_cell(arena);
+            if (arena->foods[i] >= 0) {
+                arena->has_food[arena->foods[i]] = 1;
+            }
+        }
+    }
+    for (int id = 0; id < arena->snake_count; id++) {
+        if (!arena->snakes[id].alive) {
+            arena_spawn_snake(arena, &arena->snakes[id]);
+        }
+    }
+    arena->ticks++;
+}
+
+typedef struct {
+    double seconds;
+    double tick_max;
+    long over_budget;
+    long alive_total;
+    long food_eaten;
+    long deaths;
+    long contests_lost;
+    long failed_spawns;
+    uint64_t checksum;
+} ArenaResult;
+
+ArenaResult run_arena(int snake_count, int width, int height, int thread_count,
+                      long ticks, unsigned int seed) {
+    ArenaResult result = {0};
+    Arena arena;
+    ThreadPool pool;
+    init_arena(&arena, snake_count, width, height, seed);
+    init_pool(&pool, thread_count);
+
+    for (long t = 0; t < ticks; t++) {
+        double start = seconds_now();
+        step_arena(&arena, &pool);
+        double elapsed = seconds_now() - start;
+        result.seconds += elapsed;
+        if (elapsed > result.tick_max) result.tick_max = elapsed;
+        result.over_budget += elapsed * 1e6 > ARENA_TICK_BUDGET_US;
+        for (int id = 0; id < snake_count; id++) {
+            result.alive_total += arena.snakes[id].alive;
+        }
+    }
+    destroy_pool(&pool);
+
+    result.contests_lost = arena.contests_lost;
+    result.failed_spawns = arena.failed_spawns;
+    result.checksum = 0xCBF29CE484222325ull;
+    for (int id = 0; id < snake_count; id++) {
+        ArenaSnake *snake = &arena.snakes[id];
+        result.food_eaten += snake->food_eaten;
+        result.deaths += snake->deaths;
+        // A dead snake's body is stale, or was never written if it never spawned
+        uint64_t head = snake->alive ? (uint64_t)snake->body[snake->head] : 0xFFFFFFFFull;
+        uint64_t state = (head << 32) ^ ((uint64_t)snake->length << 16) ^ (uint64_t)snake->food_eaten;
+        result.checksum = (result.checksum ^ state) * 0x100000001B3ull;
+    }
+    free_arena(&arena);
+    return result;
+}
+
+void print_arena_result(int snake_count, int width, int height, int thread_count,
+                        long ticks, ArenaResult result) {
+    printf("snakes %5d  board %5d x %-5d threads %2d  tick avg %.3f ms  max %.3f ms  "
+           "over %d us: %ld  alive avg %.0f  eaten %ld  deaths %ld (contested %ld)  "
+           "failed spawns %ld  checksum %016llx\n",
+           snake_count, width, height, thread_count, result.seconds * 1e3 / ticks,
+           result.tick_max * 1e3, ARENA_TICK_BUDGET_US, result.over_budget,
+           (double)result.alive_total / ticks, result.food_eaten, result.deaths,
+           result.contests_lost, result.failed_spawns, (unsigned long long)result.checksum);
+}
+
+// Run one arena, or a sweep over snake counts and board sizes
+void run_arena_mode(int snake_count, int width, int height, int thread_count,
+                    long ticks, unsigned int seed) {
+    if (thread_count < 1) {
+        thread_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (snake_count > 0) {
+        print_arena_result(snake_count, width, height, thread_count, ticks,
+                           run_arena(snake_count, width, height, thread_count, ticks, seed));
+        return;
+    }
+    const int sizes[][3] = { {100, 200, 200}, {300, 500, 500}, {1000, 1000, 1000}, {3000, 2000, 2000} };
+    for (int i = 0; i < 4; i++) {
+        print_arena_result(sizes[i][0], sizes[i][1], sizes[i][2], thread_count, ticks,
+                           run_arena(sizes[i][0], sizes[i][1], sizes[i][2], thread_count,
+                                     ticks, seed));
+    }
+}
+
+void print_usage(const char *program) {
+    printf("Usage: %s                  play\n", program);
+    printf("       %s --autopilot [width height] [games] [max-moves] [seed]\n", program);
+    printf("                             headless autopilot benchmark\n");
+    printf("       %s --batch [envs] [threads] [steps] [seed]\n", program);
+    printf("                             batched environment stepping benchmark\n");
+    printf("       %s --arena [snakes width height] [threads] [ticks] [seed]\n", program);
+    printf("                             multi-snake arena benchmark\n");
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && strcmp(argv[1], "--autopilot") == 0) {
+        int width = 0, height = 0;
+        int games = 0;
+        long max_moves = AUTOPILOT_MAX_MOVES;
+        unsigned int seed = 1;
+        int i = 2;
+        if (argc > 3) {
+            width = atoi(argv[2]);
+            height = atoi(argv[3]);
+            i = 4;
+            games = 1;
+            if (width < 4 || height < 4) {
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+        if (argc > i) games = atoi(argv[i]);
+        if (argc > i + 1) max_moves = atol(argv[i + 1]);
+        if (argc > i + 2) seed = (unsigned int)strtoul(argv[i + 2], NULL, 10);
+        run_autopilot_mode(width, height, games, max_moves, seed);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--batch") == 0) {
+        int env_count = argc > 2 ? atoi(argv[2]) : BATCH_ENVS;
+        int thread_count = argc > 3 ? atoi(argv[3]) : 0;
+        long steps = argc > 4 ? atol(argv[4]) : BATCH_STEPS;
+        unsigned int seed = argc > 5 ? (unsigned int)strtoul(argv[5], NULL, 10) : 1;
+        if (env_count < 1 || steps < 1) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        run_batch_mode(env_count, thread_count, steps, seed);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--arena") == 0) {
+        int snake_count = 0, width = 0, height = 0;
+        int i = 2;
+        if (argc > 4) {
+            snake_count = atoi(argv[2]);
+            width = atoi(argv[3]);
+            height = atoi(argv[4]);
+            i = 5;
+            if (snake_count < 1 || width < 8 || height < 1) {
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+        int thread_count = argc > i ? atoi(argv[i]) : 0;
+        long ticks = argc > i + 1 ? atol(argv[i + 1]) : ARENA_TICKS;
+        unsigned int seed = argc > i + 2 ? (unsigned int)strtoul(argv[i + 2], NULL, 10) : 1;
+        run_arena_mode(snake_count, width, height, thread_count, ticks, seed);
+        return 0;
+    }
+    if (argc > 1) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    Runtime runtime;
+    if (!runtime_init(&runtime, 100000)) {
+        fprintf(stderr, "Could not create the tick timer\n");
+        return 1;
+    }
+
     // Initialize ncurses
-    initscr();
+    frame_init();
     cbreak();
     noecho();
     keypad(stdscr, TRUE);
@@ -324,14 +1588,15 @@ int main() {
     // Main game loop
     do {
         game_over = 0;
+        game_won = 0;
         score = 0;
-        game_loop();
+        game_loop(&runtime);
         show_game_over();
         
         // Ask to play again
-        clear();
-        mvprintw(HEIGHT / 2 - 1, WIDTH / 2 - 10, "Play again? (y/n)");
-        refresh();
+        frame_begin();
+        frame_print(HEIGHT / 2 - 1, WIDTH / 2 - 10, 0, "Play again? (y/n)");
+        frame_present();
         
         int ch;
         while ((ch = getch()) != 'y' && ch != 'n' && ch != 'Y' && ch != 'N');
@@ -344,7 +1609,9 @@ int main() {
     } while (1);
     
     // Clean up ncurses
-    endwin();
+    frame_end();
+    runtime_report(&runtime, stderr);
+    runtime_close(&runtime);
     
     return 0;
 }
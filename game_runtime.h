@@ -0,0 +1,156 @@
+// Event-driven game loop runtime shared by the ncurses games.
+//
+// runtime_wait sleeps in poll() on stdin and a monotonic timerfd until a
+// key arrives or at least one fixed-timestep tick is due, and returns how
+// many ticks to run (0 when woken by input only). Ticks are scheduled on
+// absolute deadlines, so they do not drift, and the lateness of every
+// wakeup is recorded so jitter can be reported when the game ends.
+#ifndef GAME_RUNTIME_H
+#define GAME_RUNTIME_H
+
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+#define RUNTIME_JITTER_BUCKETS 10000 // 1 us buckets, the last one holds >= 10 ms
+
+typedef struct {
+    int timer_fd;
+    long period_ns;
+    struct timespec base;      // Deadline of tick 0 for the current period
+    uint64_t ticks_since_base;
+    struct timespec woken;     // When the last wait returned; input it found arrived no later
+    // Statistics
+    long ticks;
+    long wakeups;
+    long missed;               // Ticks that expired while an earlier one was late
+    long samples;
+    double lateness_total_us;
+    long lateness_max_us;
+    long histogram[RUNTIME_JITTER_BUCKETS];
+} Runtime;
+
+static inline long timespec_diff_ns(struct timespec a, struct timespec b) {
+    return (a.tv_sec - b.tv_sec) * 1000000000L + (a.tv_nsec - b.tv_nsec);
+}
+
+static inline struct timespec timespec_add_ns(struct timespec t, long ns) {
+    t.tv_sec += ns / 1000000000L;
+    t.tv_nsec += ns % 1000000000L;
+    if (t.tv_nsec >= 1000000000L) {
+        t.tv_sec++;
+        t.tv_nsec -= 1000000000L;
+    }
+    return t;
+}
+
+// Change the tick period, restarting the schedule from now. Does nothing
+// if the period is unchanged, so it is safe to call every tick.
+static inline void runtime_set_period(Runtime *runtime, long period_us) {
+    if (period_us * 1000 == runtime->period_ns) {
+        return;
+    }
+    runtime->period_ns = period_us * 1000;
+    clock_gettime(CLOCK_MONOTONIC, &runtime->base);
+    runtime->ticks_since_base = 0;
+
+    struct itimerspec spec;
+    spec.it_value = timespec_add_ns(runtime->base, runtime->period_ns);
+    spec.it_interval.tv_sec = runtime->period_ns / 1000000000L;
+    spec.it_interval.tv_nsec = runtime->period_ns % 1000000000L;
+    timerfd_settime(runtime->timer_fd, TFD_TIMER_ABSTIME, &spec, NULL);
+}
+
+// Restart the schedule from now, dropping ticks missed e.g. while paused
+static inline void runtime_restart(Runtime *runtime) {
+    long period_us = runtime->period_ns / 1000;
+    runtime->period_ns = 0;
+    runtime_set_period(runtime, period_us);
+}
+
+static inline bool runtime_init(Runtime *runtime, long period_us) {
+    memset(runtime, 0, sizeof(*runtime));
+    runtime->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (runtime->timer_fd < 0) {
+        return false;
+    }
+    runtime_set_period(runtime, period_us);
+    return true;
+}
+
+// Block until input is available or ticks are due. Returns the number of
+// ticks to run; the caller should drain pending input either way.
+static inline int runtime_wait(Runtime *runtime) {
+    struct pollfd fds[2] = {
+        { STDIN_FILENO, POLLIN, 0 },
+        { runtime->timer_fd, POLLIN, 0 },
+    };
+    int ready = poll(fds, 2, -1);
+    clock_gettime(CLOCK_MONOTONIC, &runtime->woken);
+    if (ready < 0) {
+        return 0; // Interrupted, e.g. by a resize signal
+    }
+    runtime->wakeups++;
+    if (!(fds[1].revents & POLLIN)) {
+        return 0;
+    }
+
+    uint64_t expirations;
+    if (read(runtime->timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+        return 0;
+    }
+    struct timespec now = runtime->woken;
+    runtime->ticks_since_base += expirations;
+
+    // Lateness of the most recent deadline that has passed
+    struct timespec deadline = timespec_add_ns(runtime->base,
+                                               (long)runtime->ticks_since_base * runtime->period_ns);
+    long lateness_us = timespec_diff_ns(now, deadline) / 1000;
+    if (lateness_us < 0) lateness_us = 0;
+    runtime->histogram[lateness_us < RUNTIME_JITTER_BUCKETS ? lateness_us : RUNTIME_JITTER_BUCKETS - 1]++;
+    runtime->lateness_total_us += lateness_us;
+    if (lateness_us > runtime->lateness_max_us) runtime->lateness_max_us = lateness_us;
+    runtime->samples++;
+
+    runtime->missed += expirations - 1;
+    runtime->ticks += expirations;
+    return (int)expirations;
+}
+
+static inline long runtime_percentile_us(const Runtime *runtime, double fraction) {
+    long target = (long)(runtime->samples * fraction);
+    long seen = 0;
+    for (int i = 0; i < RUNTIME_JITTER_BUCKETS; i++) {
+        seen += runtime->histogram[i];
+        if (seen > target) {
+            return i;
+        }
+    }
+    return RUNTIME_JITTER_BUCKETS - 1;
+}
+
+static inline void runtime_report(const Runtime *runtime, FILE *out) {
+    if (runtime->samples == 0) {
+        return;
+    }
+    fprintf(out, "Ticks: %ld  wakeups: %ld  missed: %ld  tick lateness: mean %.1f us  "
+            "p50 %ld us  p99 %ld us  max %ld us\n",
+            runtime->ticks, runtime->wakeups, runtime->missed,
+            runtime->lateness_total_us / runtime->samples,
+            runtime_percentile_us(runtime, 0.50), runtime_percentile_us(runtime, 0.99),
+            runtime->lateness_max_us);
+}
+
+static inline void runtime_close(Runtime *runtime) {
+    if (runtime->timer_fd >= 0) {
+        close(runtime->timer_fd);
+    }
+    runtime->timer_fd = -1;
+}
+
+#endif
@@ -1,16 +1,65 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
 #include <ncurses.h>
 #include <unistd.h>
 #include <time.h>
 #include <stdbool.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "term_frame.h"
+#include "game_runtime.h"
+#include "thread_pool.h"
 
-#define BALL_DELAY 50000
-#define AI_DIFFICULTY 0.8 // Lower is harder (0.5-0.9 recommended)
+#define PHYSICS_HZ 120 // Fixed simulation rate, independent of drawing
+#define FRAME_HZ 60     // Frames drawn per second while nothing is pressed
+#define LOGIC_HZ 20     // AI moves and power-up rolls keep the original 50 ms cadence
+#define FIXED_SHIFT 16  // Ball position and velocity are in 1/65536 cell units
+#define FIXED_ONE (1 << FIXED_SHIFT)
+#define BALL_SPEED 20   // Cells per second across the court
+#define BALL_MAX_VY 30  // Cells per second up or down, off a paddle's edge
+#define SPEED_BOOST_STEPS (PHYSICS_HZ * 5 / 2) // 2.5 seconds at double speed
+#define POWERUP_LIFETIME_STEPS (PHYSICS_HZ * 5)
+#define AI_REACTION_MS 150 // Opponent AI in single player mode
+#define AI_ERROR 1.5f      // Cells the opponent AI may misjudge the ball by
+
+// Headless AI-vs-AI simulator
+#define SIM_MATCHES 2000
+#define SIM_WIDTH 80
+#define SIM_HEIGHT 24
+#define MATCH_POINTS 11
+#define MATCH_MAX_STEPS (PHYSICS_HZ * 600) // Give up on a match after ten minutes
+#define RALLY_BUCKETS 64   // Rally length histogram; the last bucket holds longer rallies
+
+// Wakeup-to-present latency measurement
+#define INPUT_QUEUE 256       // Keys awaiting the frame that shows them
+#define LATENCY_BUCKETS 10000 // 10 us buckets; the last one holds >= 100 ms
+
+// Two-process play over a Unix domain socket
+#define NET_SOCKET "/tmp/pong.sock"
+#define NET_HISTORY 128       // Ticks of snapshots and inputs kept
+#define NET_ROLLBACK_TICKS 64 // Furthest the game runs ahead of the other side's input
+#define NET_SEND_WINDOW 32    // Unacknowledged inputs resent in each packet
+#define NET_QUEUE 256         // Packets held back by the injected delay
+#define NET_SYNC_INTERVAL 60  // Ticks between time sync adjustments
+#define NET_CONNECT_TRIES 50  // 100 ms apart
+
+// Multi-ball stress mode on a large virtual court
+#define STRESS_BALLS 2000
+#define STRESS_POWERUPS 500
+#define STRESS_WIDTH 1000
+#define STRESS_HEIGHT 500
+#define STRESS_TICKS 1000
+#define STRESS_PADDLE_SPACING 16 // Rows per paddle along each side
+#define STRESS_GRID 8            // Power-up grid cell size, in court cells
 
 typedef struct {
-    int x, y;
+    int x, y;              // Cell the ball is drawn in
     int original_x, original_y;
+    int fx, fy;            // Position of the ball's center, fixed point
+    int vx, vy;            // Velocity per physics step, fixed point
 } Ball;
 
 typedef struct {
@@ -23,27 +72,106 @@ typedef struct {
     int x, y;
     int type; // 1: enlarge paddle, 2: speed boost, 3: extra points
     bool active;
-    time_t spawn_time;
+    long spawn_step;
 } PowerUp;
 
+// Predictive AI: once the ball heads its way and the reaction delay has
+// passed, it works out the row where the ball will reach its paddle, wall
+// bounces included, misjudges it by up to error cells and moves there.
+typedef struct {
+    bool enabled;
+    int reaction_steps;
+    float error;
+    int wait;        // Steps left before reacting
+    int target_row;  // Row to meet the ball at, -1 until it has reacted
+} PaddleAI;
+
+// Everything the simulation touches, so headless matches can run side by
+// side on worker threads
+typedef struct {
+    int width, height;     // Court size in cells
+    Ball ball;
+    Paddle player, opponent;
+    PowerUp powerup;
+    PaddleAI player_ai, opponent_ai;
+    int player_score;
+    int opponent_score;
+    int speed_boost; // Physics steps left at double speed
+    long steps;
+    unsigned int rng_state;
+    // Rally statistics
+    int rally;       // Paddle hits since the serve
+    int rallies;
+    long rally_hits;
+    int rally_max;
+    int rally_histogram[RALLY_BUCKETS];
+    int powerups_taken;
+} PongGame;
+
+// A key as read from the terminal, stamped with the wakeup that found it.
+// The key arrived no later than that, but how much earlier can't be seen
+// through getch(), so keys drained together all share one stamp.
+typedef struct {
+    int key;
+    struct timespec woken;
+} InputEvent;
+
+// Time from the wakeup that found a key to the end of writing the frame that
+// shows its effect. This is a lower bound on input latency: it misses how long
+// the key sat in the terminal before the wakeup, and the terminal draws after
+// the frame is written.
+typedef struct {
+    InputEvent pending[INPUT_QUEUE]; // Applied, not yet on screen
+    int pending_count;
+    long samples;
+    long dropped;       // Keys past the end of pending, not measured
+    double total_us;
+    long max_us;
+    long histogram[LATENCY_BUCKETS];
+} WakeLatency;
+
 // Game state
 bool game_over = false;
-int player_score = 0;
-int opponent_score = 0;
 int game_mode = 1; // 1: single player, 2: two players
-int speed_boost = 0;
-int ball_delay = BALL_DELAY;
 const int INITIAL_PADDLE_SIZE = 4; // Initial paddle size
+Runtime runtime; // Ticks the physics at PHYSICS_HZ
+WakeLatency wake_latency;
+
+unsigned int next_random(unsigned int *state) {
+    unsigned int z = (*state += 0x9E3779B9u);
+    z = (z ^ (z >> 16)) * 0x85EBCA6Bu;
+    z = (z ^ (z >> 13)) * 0xC2B2AE35u;
+    return z ^ (z >> 16);
+}
 
-void init_ball(Ball *ball) {
-    ball->original_x = COLS / 2;
-    ball->original_y = LINES / 2;
+int to_fixed(int cells) {
+    return cells * FIXED_ONE;
+}
+
+// Cell containing a fixed point coordinate, cells being centered on integers
+int to_cell(int fixed) {
+    return (fixed + FIXED_ONE / 2) >> FIXED_SHIFT;
+}
+
+// Put the ball in the middle, moving towards dir_x (1 or -1) at 45 degrees
+void launch_ball(PongGame *game, int dir_x) {
+    Ball *ball = &game->ball;
     ball->x = ball->original_x;
     ball->y = ball->original_y;
+    ball->fx = to_fixed(ball->x);
+    ball->fy = to_fixed(ball->y);
+    ball->vx = dir_x * BALL_SPEED * FIXED_ONE / PHYSICS_HZ;
+    ball->vy = ((next_random(&game->rng_state) % 2) ? 1 : -1) * BALL_SPEED * FIXED_ONE / PHYSICS_HZ;
 }
 
-void init_paddle(Paddle *paddle, int x_pos) {
-    paddle->original_y = LINES / 2 - INITIAL_PADDLE_SIZE / 2;
+void init_ball(PongGame *game) {
+    game->ball.original_x = game->width / 2;
+    game->ball.original_y = game->height / 2;
+    launch_ball(game, (next_random(&game->rng_state) % 2) ? 1 : -1);
+}
+
+void init_paddle(PongGame *game, Paddle *paddle, int x_pos) {
+    paddle->original_y = game->height / 2 - INITIAL_PADDLE_SIZE / 2;
     paddle->y = paddle->original_y;
     paddle->x = x_pos;
     paddle->size = INITIAL_PADDLE_SIZE;
@@ -53,30 +181,48 @@ void init_powerup(PowerUp *powerup) {
     powerup->active = false;
 }
 
+void init_paddle_ai(PaddleAI *ai, bool enabled, int reaction_ms, float error) {
+    ai->enabled = enabled;
+    ai->reaction_steps = reaction_ms * PHYSICS_HZ / 1000;
+    ai->error = error;
+    ai->wait = ai->reaction_steps;
+    ai->target_row = -1;
+}
+
+void init_game(PongGame *game, int width, int height, unsigned int seed) {
+    memset(game, 0, sizeof(*game));
+    game->width = width;
+    game->height = height;
+    game->rng_state = seed;
+    init_ball(game);
+    init_paddle(game, &game->player, 2);
+    init_paddle(game, &game->opponent, width - 3);
+    init_powerup(&game->powerup);
+}
+
 void draw_border() {
     for (int i = 0; i < COLS; i++) {
-        mvprintw(0, i, "-");
-        mvprintw(LINES - 1, i, "-");
+        frame_print(0, i, 0, "-");
+        frame_print(LINES - 1, i, 0, "-");
     }
     for (int i = 0; i < LINES; i++) {
-        mvprintw(i, 0, "|");
-        mvprintw(i, COLS - 1, "|");
+        frame_print(i, 0, 0, "|");
+        frame_print(i, COLS - 1, 0, "|");
     }
 }
 
 void draw_ball(Ball *ball) {
-    mvprintw(ball->y, ball->x, "O");
+    frame_print(ball->y, ball->x, 0, "O");
 }
 
 void draw_paddle(Paddle *paddle) {
     for (int i = 0; i < paddle->size; i++) {
-        mvprintw(paddle->y + i, paddle->x, "|");
+        frame_print(paddle->y + i, paddle->x, 0, "|");
     }
 }
 
 void draw_powerup(PowerUp *powerup) {
     if (powerup->active) {
-        attron(COLOR_PAIR(1));
         char symbol;
         switch (powerup->type) {
             case 1: symbol = 'E'; break; // Enlarge
@@ -84,131 +230,241 @@ void draw_powerup(PowerUp *powerup) {
             case 3: symbol = 'P'; break; // Points
             default: symbol = '?';
         }
-        mvprintw(powerup->y, powerup->x, "%c", symbol);
-        attroff(COLOR_PAIR(1));
+        frame_print(powerup->y, powerup->x, 1, "%c", symbol);
     }
 }
 
-void draw_scores() {
-    mvprintw(1, COLS / 2 - 4, "%02d - %02d", player_score, opponent_score);
+void draw_scores(PongGame *game) {
+    frame_print(1, COLS / 2 - 4, 0, "%02d - %02d", game->player_score, game->opponent_score);
 }
 
 void draw_instructions() {
-    mvprintw(LINES - 2, 2, "Q: Quit | P: Pause | R: Reset | M: Change Mode");
+    frame_print(LINES - 2, 2, 0, "Q: Quit | P: Pause | R: Reset | M: Change Mode");
 }
 
-void reset_game(Ball *ball, Paddle *player, Paddle *opponent) {
-    ball->x = ball->original_x;
-    ball->y = ball->original_y;
-    player->y = player->original_y;
-    opponent->y = opponent->original_y;
-    player->size = INITIAL_PADDLE_SIZE;
-    opponent->size = INITIAL_PADDLE_SIZE;
-    speed_boost = 0;
-    ball_delay = BALL_DELAY;
-}
-
-void spawn_powerup(PowerUp *powerup, Ball *ball) {
-    if (rand() % 100 < 15 && !powerup->active) { // 15% chance to spawn
-        powerup->x = rand() % (COLS - 4) + 2;
-        powerup->y = rand() % (LINES - 4) + 2;
-        powerup->type = rand() % 3 + 1;
+void reset_game(PongGame *game, int dir_x) {
+    launch_ball(game, dir_x);
+    game->player.y = game->player.original_y;
+    game->opponent.y = game->opponent.original_y;
+    game->player.size = INITIAL_PADDLE_SIZE;
+    game->opponent.size = INITIAL_PADDLE_SIZE;
+    game->speed_boost = 0;
+    game->rally = 0;
+}
+
+void spawn_powerup(PongGame *game) {
+    PowerUp *powerup = &game->powerup;
+    if (next_random(&game->rng_state) % 100 < 15 && !powerup->active) { // 15% chance to spawn
+        powerup->x = next_random(&game->rng_state) % (game->width - 4) + 2;
+        powerup->y = next_random(&game->rng_state) % (game->height - 4) + 2;
+        powerup->type = next_random(&game->rng_state) % 3 + 1;
         powerup->active = true;
-        powerup->spawn_time = time(NULL);
+        powerup->spawn_step = game->steps;
     }
 }
 
-void check_powerup_collision(PowerUp *powerup, Ball *ball, Paddle *player, Paddle *opponent) {
-    if (powerup->active && 
+void check_powerup_collision(PongGame *game) {
+    PowerUp *powerup = &game->powerup;
+    Ball *ball = &game->ball;
+    if (powerup->active &&
         ((ball->x >= powerup->x - 1 && ball->x <= powerup->x + 1) &&
         (ball->y >= powerup->y - 1 && ball->y <= powerup->y + 1))) {
-        
+
         // Apply powerup effect
         switch (powerup->type) {
             case 1: // Enlarge paddle
-                if (ball->x < COLS / 2) {
+                if (ball->x < game->width / 2) {
                     // Player paddle
-                    if (player->size < 8) player->size += 2;
+                    if (game->player.size < 8) game->player.size += 2;
                 } else {
                     // Opponent paddle
-                    if (opponent->size < 8) opponent->size += 2;
+                    if (game->opponent.size < 8) game->opponent.size += 2;
                 }
                 break;
             case 2: // Speed boost
-                speed_boost = 100;
-                ball_delay = BALL_DELAY / 2;
+                game->speed_boost = SPEED_BOOST_STEPS;
                 break;
             case 3: // Extra points
-                if (ball->x < COLS / 2) {
-                    player_score += 2;
+                if (ball->x < game->width / 2) {
+                    game->player_score += 2;
                 } else {
-                    opponent_score += 2;
+                    game->opponent_score += 2;
                 }
                 break;
         }
         powerup->active = false;
+        game->powerups_taken++;
     }
-    
+
     // Powerup timeout (5 seconds)
-    if (powerup->active && difftime(time(NULL), powerup->spawn_time) > 5) {
+    if (powerup->active && game->steps - powerup->spawn_step > POWERUP_LIFETIME_STEPS) {
         powerup->active = false;
     }
 }
 
-void move_ball(Ball *ball, int *ball_dir_x, int *ball_dir_y, Paddle *player, Paddle *opponent) {
-    // Move ball
-    ball->x += *ball_dir_x;
-    ball->y += *ball_dir_y;
-    
-    // Check collision with top and bottom
-    if (ball->y <= 1 || ball->y >= LINES - 2) {
-        *ball_dir_y *= -1;
-    }
-    
-    // Check collision with paddles
-    if ((ball->x == player->x + 1 && 
-         ball->y >= player->y && 
-         ball->y < player->y + player->size) ||
-        (ball->x == opponent->x - 1 && 
-         ball->y >= opponent->y && 
-         ball->y < opponent->y + opponent->size)) {
-        *ball_dir_x *= -1;
-        
-        // Add some randomness to the bounce
-        if (rand() % 2) {
-            *ball_dir_y = (*ball_dir_y == 1) ? -1 : 1;
-        }
-    }
-    
+// Fold a coordinate back into [low, high] as if it had bounced between
+// walls at both ends. Sets *flipped if it bounced an odd number of times.
+int fold(int value, int low, int high, bool *flipped) {
+    int span = high - low;
+    int offset = (value - low) % (2 * span);
+    if (offset < 0) offset += 2 * span;
+    *flipped = offset > span;
+    return *flipped ? high - (offset - span) : low + offset;
+}
+
+// Column of a paddle's face, where the ball's center bounces off it
+int paddle_face(PongGame *game, Paddle *paddle) {
+    return paddle == &game->player ? paddle->x + 1 : paddle->x - 1;
+}
+
+// A point is over: record the rally and serve towards the side that won it
+void score_point(PongGame *game, bool player_won) {
+    if (player_won) {
+        game->player_score++;
+    } else {
+        game->opponent_score++;
+    }
+    game->rallies++;
+    game->rally_hits += game->rally;
+    if (game->rally > game->rally_max) game->rally_max = game->rally;
+    game->rally_histogram[game->rally < RALLY_BUCKETS ? game->rally : RALLY_BUCKETS - 1]++;
+    reset_game(game, player_won ? -1 : 1);
+}
+
+// Advance the ball by one physics step. The step is swept: the segment the
+// ball travels is tested against the face of the paddle it moves towards,
+// with wall bounces folded in, so a fast ball can't pass through a paddle.
+void move_ball(PongGame *game) {
+    Ball *ball = &game->ball;
+    int low = to_fixed(1);
+    int high = to_fixed(game->height - 2);
+    int x0 = ball->fx;
+    int x1 = x0 + ball->vx;
+    int start_y = ball->fy;
+    long long remaining = 1; // Fraction of the step left after a hit, as a ratio
+    long long whole = 1;
+
+    Paddle *paddle = ball->vx < 0 ? &game->player : &game->opponent;
+    int face = to_fixed(paddle_face(game, paddle));
+    bool crosses = ball->vx < 0 ? (x0 >= face && x1 < face) : (x0 <= face && x1 > face);
+    if (crosses) {
+        // Where the ball is when it reaches the face
+        long long travelled = face - x0;
+        long long step = x1 - x0;
+        bool flipped;
+        int hit_y = fold(ball->fy + (int)(ball->vy * travelled / step), low, high, &flipped);
+        int row = to_cell(hit_y);
+        if (row >= paddle->y && row < paddle->y + paddle->size) {
+            x1 = 2 * face - x1;
+            ball->vx = -ball->vx;
+            game->rally++;
+
+            // The further from the paddle's center, the steeper the bounce
+            int center = to_fixed(paddle->y) + to_fixed(paddle->size - 1) / 2;
+            int half = to_fixed(paddle->size) / 2;
+            long long max_vy = (long long)BALL_MAX_VY * FIXED_ONE / PHYSICS_HZ;
+            long long vy = max_vy * (hit_y - center) / half;
+            if (vy > max_vy) vy = max_vy;
+            if (vy < -max_vy) vy = -max_vy;
+            ball->vy = (int)vy;
+
+            start_y = hit_y;
+            remaining = step - travelled;
+            whole = step;
+        }
+    }
+
+    bool flipped;
+    ball->fy = fold(start_y + (int)(ball->vy * remaining / whole), low, high, &flipped);
+    if (flipped) {
+        ball->vy = -ball->vy;
+    }
+    ball->fx = x1;
+    ball->x = to_cell(ball->fx);
+    ball->y = to_cell(ball->fy);
+
     // Check if ball went past paddles
     if (ball->x <= 1) {
-        opponent_score++;
-        reset_game(ball, player, opponent);
-        *ball_dir_x = 1;
-    } else if (ball->x >= COLS - 2) {
-        player_score++;
-        reset_game(ball, player, opponent);
-        *ball_dir_x = -1;
-    }
-}
-
-void move_ai_paddle(Paddle *paddle, Ball *ball, int ball_dir_x) {
-    // Only move if ball is coming towards AI
-    if (ball_dir_x > 0) {
-        // Move paddle towards ball with some imperfection
-        if (paddle->y + paddle->size / 2 < ball->y && rand() / (float)RAND_MAX > AI_DIFFICULTY) {
-            if (paddle->y < LINES - paddle->size - 2) {
-                paddle->y++;
-            }
-        } else if (paddle->y + paddle->size / 2 > ball->y && rand() / (float)RAND_MAX > AI_DIFFICULTY) {
-            if (paddle->y > 1) {
-                paddle->y--;
-            }
+        score_point(game, false);
+    } else if (ball->x >= game->width - 2) {
+        score_point(game, true);
+    }
+}
+
+// Row where the ball's center will reach a paddle's face if nothing else
+// touches it, following the same wall folding as move_ball
+int predict_row(PongGame *game, Paddle *paddle) {
+    Ball *ball = &game->ball;
+    long long distance = to_fixed(paddle_face(game, paddle)) - ball->fx;
+    bool flipped;
+    int y = fold(ball->fy + (int)(ball->vy * distance / ball->vx),
+                 to_fixed(1), to_fixed(game->height - 2), &flipped);
+    return to_cell(y);
+}
+
+// Move a paddle by dy cells, keeping it on the court
+void move_paddle(PongGame *game, Paddle *paddle, int dy) {
+    for (; dy < 0 && paddle->y > 1; dy++) {
+        paddle->y--;
+    }
+    for (; dy > 0 && paddle->y < game->height - paddle->size - 2; dy--) {
+        paddle->y++;
+    }
+}
+
+// Move an AI paddle one cell, called at LOGIC_HZ like the original AI
+void move_ai_paddle(PongGame *game, Paddle *paddle, PaddleAI *ai) {
+    Ball *ball = &game->ball;
+    bool incoming = paddle == &game->player ? ball->vx < 0 : ball->vx > 0;
+    int target;
+    if (!incoming) {
+        // Drift back to the middle and get ready to react again
+        ai->wait = ai->reaction_steps;
+        ai->target_row = -1;
+        target = game->height / 2;
+    } else if (ai->wait > 0) {
+        ai->wait -= PHYSICS_HZ / LOGIC_HZ;
+        return;
+    } else {
+        if (ai->target_row < 0) {
+            float miss = ((int)(next_random(&game->rng_state) % 2001) - 1000) / 1000.0f * ai->error;
+            ai->target_row = predict_row(game, paddle) + (int)(miss + (miss < 0 ? -0.5f : 0.5f));
         }
+        target = ai->target_row;
+    }
+
+    int center = paddle->y + paddle->size / 2;
+    move_paddle(game, paddle, (center < target) - (center > target));
+}
+
+// Advance the game by one physics step
+void step_game(PongGame *game) {
+    game->steps++;
+    if (game->steps % (PHYSICS_HZ / LOGIC_HZ) == 0) {
+        if (game->player_ai.enabled) {
+            move_ai_paddle(game, &game->player, &game->player_ai);
+        }
+        if (game->opponent_ai.enabled) {
+            move_ai_paddle(game, &game->opponent, &game->opponent_ai);
+        }
+        spawn_powerup(game);
+    }
+
+    // Move ball, twice per step while boosted
+    for (int pass = 0; pass < (game->speed_boost > 0 ? 2 : 1); pass++) {
+        move_ball(game);
+        check_powerup_collision(game);
+    }
+
+    // Decrease speed boost over time
+    if (game->speed_boost > 0) {
+        game->speed_boost--;
     }
 }
 
-void handle_input(int ch, Paddle *player, Paddle *opponent, Ball *ball, int *ball_dir_x, int *ball_dir_y) {
+void handle_input(PongGame *game, int ch) {
+    Paddle *player = &game->player;
+    Paddle *opponent = &game->opponent;
     switch (ch) {
         case 'q':
         case 'Q':
@@ -216,124 +472,1243 @@ void handle_input(int ch, Paddle *player, Paddle *opponent, Ball *ball, int *bal
             break;
         case 'w':
         case 'W':
-            if (player->y > 1) {
-                player->y--;
-            }
+            move_paddle(game, player, -1);
             break;
         case 's':
         case 'S':
-            if (player->y < LINES - player->size - 2) {
-                player->y++;
-            }
+            move_paddle(game, player, 1);
             break;
         case KEY_UP:
-            if (game_mode == 2 && opponent->y > 1) {
-                opponent->y--;
+            if (game_mode == 2) {
+                move_paddle(game, opponent, -1);
             }
             break;
         case KEY_DOWN:
-            if (game_mode == 2 && opponent->y < LINES - opponent->size - 2) {
-                opponent->y++;
+            if (game_mode == 2) {
+                move_paddle(game, opponent, 1);
             }
             break;
         case 'r':
         case 'R':
-            player_score = 0;
-            opponent_score = 0;
-            reset_game(ball, player, opponent);
-            *ball_dir_x = (rand() % 2) ? 1 : -1;
-            *ball_dir_y = (rand() % 2) ? 1 : -1;
+            game->player_score = 0;
+            game->opponent_score = 0;
+            reset_game(game, (next_random(&game->rng_state) % 2) ? 1 : -1);
             break;
         case 'm':
         case 'M':
             game_mode = (game_mode == 1) ? 2 : 1;
-            reset_game(ball, player, opponent);
-            *ball_dir_x = (rand() % 2) ? 1 : -1;
-            *ball_dir_y = (rand() % 2) ? 1 : -1;
+            game->opponent_ai.enabled = game_mode == 1;
+            reset_game(game, (next_random(&game->rng_state) % 2) ? 1 : -1);
             break;
         case 'p':
         case 'P':
-            // Pause game
-            while ((ch = getch()) != 'p' && ch != 'P') {
-                mvprintw(LINES / 2, COLS / 2 - 5, "PAUSED");
-                refresh();
-                usleep(100000);
+            // Pause game, waiting for the key without spinning
+            frame_print(LINES / 2, COLS / 2 - 5, 0, "PAUSED");
+            frame_present();
+            nodelay(stdscr, FALSE);
+            while ((ch = getch()) != 'p' && ch != 'P');
+            nodelay(stdscr, TRUE);
+            runtime_restart(&runtime); // Don't catch up on the paused time
+            wake_latency.pending_count = 0; // Their frame waited for the pause
+            break;
+    }
+}
+
+double seconds_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Remember an applied key until the next frame is written
+void input_applied(WakeLatency *latency, const InputEvent *event) {
+    if (latency->pending_count == INPUT_QUEUE) {
+        latency->dropped++;
+        return;
+    }
+    latency->pending[latency->pending_count++] = *event;
+}
+
+// A frame has been written: every pending key is now on screen
+void input_presented(WakeLatency *latency) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    for (int i = 0; i < latency->pending_count; i++) {
+        long us = timespec_diff_ns(now, latency->pending[i].woken) / 1000;
+        latency->histogram[us / 10 < LATENCY_BUCKETS ? us / 10 : LATENCY_BUCKETS - 1]++;
+        latency->total_us += us;
+        if (us > latency->max_us) latency->max_us = us;
+        latency->samples++;
+    }
+    latency->pending_count = 0;
+}
+
+long wake_latency_percentile_us(const WakeLatency *latency, double fraction) {
+    long target = (long)(latency->samples * fraction);
+    long seen = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += latency->histogram[i];
+        if (seen > target) {
+            return i * 10;
+        }
+    }
+    return (LATENCY_BUCKETS - 1) * 10;
+}
+
+void wake_latency_report(const WakeLatency *latency, FILE *out) {
+    if (latency->samples == 0) {
+        return;
+    }
+    fprintf(out, "Wakeup-to-present latency (lower bound): keys %ld  mean %.0f us  p50 %ld us  p99 %ld us  max %ld us  "
+            "not measured %ld\n",
+            latency->samples, latency->total_us / latency->samples,
+            wake_latency_percentile_us(latency, 0.50), wake_latency_percentile_us(latency, 0.99),
+            latency->max_us, latency->dropped);
+}
+
+// AI settings for one side of a simulated match
+typedef struct {
+    int reaction_ms;
+    float error;
+} AISettings;
+
+typedef struct {
+    AISettings left, right;
+    unsigned int seed;
+    PongGame *games; // One per match, kept for the totals
+} MatchSet;
+
+void play_match(void *context, int index) {
+    MatchSet *set = context;
+    PongGame *game = &set->games[index];
+    init_game(game, SIM_WIDTH, SIM_HEIGHT, set->seed + index);
+    init_paddle_ai(&game->player_ai, true, set->left.reaction_ms, set->left.error);
+    init_paddle_ai(&game->opponent_ai, true, set->right.reaction_ms, set->right.error);
+    while (game->player_score < MATCH_POINTS && game->opponent_score < MATCH_POINTS &&
+           game->steps < MATCH_MAX_STEPS) {
+        step_game(game);
+    }
+}
+
+// Rally length that fraction of all rallies are no longer than
+int rally_percentile(const long *histogram, long rallies, double fraction) {
+    long seen = 0;
+    for (int i = 0; i < RALLY_BUCKETS; i++) {
+        seen += histogram[i];
+        if (seen > (long)(rallies * fraction)) {
+            return i;
+        }
+    }
+    return RALLY_BUCKETS - 1;
+}
+
+// Play one pairing across the pool and print the results. Each match is
+// seeded from its index, so the totals don't depend on the thread count.
+void run_matches(AISettings left, AISettings right, int matches, ThreadPool *pool,
+                 unsigned int seed) {
+    MatchSet set = { left, right, seed, malloc(matches * sizeof(PongGame)) };
+    double start = seconds_now();
+    run_pool(pool, matches, play_match, &set);
+    double seconds = seconds_now() - start;
+
+    int left_wins = 0, right_wins = 0;
+    long rallies = 0, hits = 0, steps = 0, powerups = 0;
+    int rally_max = 0;
+    long histogram[RALLY_BUCKETS] = {0};
+    unsigned long checksum = 0;
+    for (int i = 0; i < matches; i++) {
+        PongGame *game = &set.games[i];
+        if (game->player_score >= MATCH_POINTS) {
+            left_wins++;
+        } else if (game->opponent_score >= MATCH_POINTS) {
+            right_wins++;
+        }
+        rallies += game->rallies;
+        hits += game->rally_hits;
+        steps += game->steps;
+        powerups += game->powerups_taken;
+        if (game->rally_max > rally_max) rally_max = game->rally_max;
+        for (int b = 0; b < RALLY_BUCKETS; b++) {
+            histogram[b] += game->rally_histogram[b];
+        }
+        checksum = checksum * 31 + game->steps * 1000 + game->player_score * 100 + game->opponent_score;
+    }
+
+    printf("%3d ms/%.1f vs %3d ms/%.1f: wins %5.1f%% - %5.1f%%  unfinished %d  "
+           "rally avg %.1f p50 %d p90 %d max %d  power-ups/match %.1f\n",
+           left.reaction_ms, left.error, right.reaction_ms, right.error,
+           100.0 * left_wins / matches, 100.0 * right_wins / matches,
+           matches - left_wins - right_wins, rallies ? (double)hits / rallies : 0.0,
+           rally_percentile(histogram, rallies, 0.50), rally_percentile(histogram, rallies, 0.90),
+           rally_max, (double)powerups / matches);
+    printf("    %d matches in %.3f s (%.0f matches/sec, %.1f M steps/sec)  checksum %016lx\n",
+           matches, seconds, matches / seconds, steps / seconds / 1e6, checksum);
+    free(set.games);
+}
+
+// Headless AI-vs-AI matches: one pairing if given, otherwise the single
+// player opponent AI against a sweep of reaction delays and errors
+void run_sim_mode(int matches, int thread_count, unsigned int seed,
+                  AISettings *left, AISettings *right) {
+    if (thread_count < 1) {
+        thread_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    ThreadPool pool;
+    init_pool(&pool, thread_count);
+    printf("%d matches per pairing to %d points on a %dx%d court, %d threads\n",
+           matches, MATCH_POINTS, SIM_WIDTH, SIM_HEIGHT, thread_count);
+
+    if (left && right) {
+        run_matches(*left, *right, matches, &pool, seed);
+    } else {
+        AISettings reference = { AI_REACTION_MS, AI_ERROR };
+        const int reactions[] = { 100, 1000, 2500 };
+        const float errors[] = { 0.5f, 1.5f, 2.5f, 4.0f };
+        for (int r = 0; r < 3; r++) {
+            for (int e = 0; e < 4; e++) {
+                AISettings challenger = { reactions[r], errors[e] };
+                run_matches(reference, challenger, matches, &pool, seed);
             }
+        }
+    }
+    destroy_pool(&pool);
+}
+
+// Two players, one process each, joined by a Unix domain socket. Each
+// side runs every tick as soon as it is due with its own input and a guess
+// of no move for the other side's, so its own paddle answers within a
+// frame however slow the link is. Inputs go out every tick and are resent
+// until acknowledged. When one arrives that differs from the guess, the
+// game is rolled back to the snapshot before that tick and replayed.
+typedef struct {
+    int32_t first;      // Tick of moves[0]
+    int32_t tick;       // Sender's current tick
+    int32_t ack;        // Sender has our inputs for every tick before this
+    int32_t synced;     // sync_hash is of the state after tick synced - 1, if > 0
+    uint32_t sync_hash;
+    int16_t advantage;  // Sender's tick minus the newest tick it has heard from us
+    uint8_t count;
+    uint8_t quit;
+    int8_t moves[NET_SEND_WINDOW];
+} NetPacket;
+
+typedef struct {
+    uint32_t seed;
+    int32_t width, height;
+} NetHello;
+
+typedef struct {
+    double due;
+    NetPacket packet;
+} DelayedPacket;
+
+typedef struct {
+    int fd;
+    bool host;                // The host plays the left paddle
+    PongGame game;            // State before tick
+    int tick;
+    PongGame snapshots[NET_HISTORY]; // State before each recent tick
+    int8_t local_moves[NET_HISTORY];
+    int8_t remote_moves[NET_HISTORY];
+    double sent_at[NET_HISTORY];
+    int remote_received;      // Remote inputs are known for every tick before this
+    int local_acked;          // The other side has ours for every tick before this
+    int remote_tick;
+    int remote_advantage;
+    int rollback_from;        // Earliest tick run with a wrong guess, or tick
+    int peer_synced;          // Latest state hash from the other side
+    uint32_t peer_hash;
+    int since_sync;
+    bool stalled;
+    bool remote_quit;
+    // Injected link conditions
+    int delay_ms;
+    int loss_percent;
+    unsigned int loss_state;
+    DelayedPacket queue[NET_QUEUE];
+    int queue_head;
+    int queue_count;
+    // Statistics
+    long rollbacks;
+    long resimulated;
+    int resimulated_max;
+    long stalls;
+    long skipped;
+    long packets_sent;
+    long packets_lost;
+    long packets_received;
+    double rtt_total;
+    long rtt_samples;
+    double rtt_last;
+    long sync_checks;
+    long desyncs;
+} NetSession;
+
+// FNV-1a over the state both sides must agree on
+uint32_t hash_game(const PongGame *game) {
+    int fields[] = {
+        game->ball.fx, game->ball.fy, game->ball.vx, game->ball.vy,
+        game->player.y, game->player.size, game->opponent.y, game->opponent.size,
+        game->powerup.active, game->powerup.x, game->powerup.y, game->powerup.type,
+        game->player_score, game->opponent_score, game->speed_boost,
+        (int)game->steps, (int)game->rng_state,
+    };
+    uint32_t hash = 2166136261u;
+    const unsigned char *bytes = (const unsigned char *)fields;
+    for (size_t i = 0; i < sizeof(fields); i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// State after a recent tick
+const PongGame *net_state_after(NetSession *net, int tick) {
+    return tick + 1 < net->tick ? &net->snapshots[(tick + 1) % NET_HISTORY] : &net->game;
+}
+
+// Run one tick from the current state, guessing no move where the other
+// side's input hasn't arrived
+void net_simulate(NetSession *net, int tick) {
+    int slot = tick % NET_HISTORY;
+    int remote = tick < net->remote_received ? net->remote_moves[slot] : 0;
+    net->snapshots[slot] = net->game;
+    move_paddle(&net->game, &net->game.player, net->host ? net->local_moves[slot] : remote);
+    move_paddle(&net->game, &net->game.opponent, net->host ? remote : net->local_moves[slot]);
+    step_game(&net->game);
+}
+
+// Run the next tick with the local player's moves. Returns false without
+// running it when the other side has fallen too far behind to roll back.
+bool net_advance(NetSession *net, int moves) {
+    if (net->tick - net->remote_received >= NET_ROLLBACK_TICKS ||
+        net->tick - net->local_acked >= NET_ROLLBACK_TICKS) {
+        net->stalls++;
+        net->stalled = true;
+        return false;
+    }
+    net->stalled = false;
+    int slot = net->tick % NET_HISTORY;
+    net->local_moves[slot] = moves < -100 ? -100 : moves > 100 ? 100 : moves;
+    net->sent_at[slot] = seconds_now();
+    net_simulate(net, net->tick);
+    net->tick++;
+    net->rollback_from = net->tick;
+    net->since_sync++;
+    return true;
+}
+
+// Send this side's unacknowledged inputs through the injected delay and loss
+void net_send(NetSession *net) {
+    NetPacket packet;
+    memset(&packet, 0, sizeof(packet));
+    packet.tick = net->tick;
+    packet.ack = net->remote_received;
+    packet.advantage = net->tick - net->remote_tick;
+    packet.first = net->local_acked;
+    int count = net->tick - net->local_acked;
+    packet.count = count < NET_SEND_WINDOW ? count : NET_SEND_WINDOW;
+    for (int i = 0; i < packet.count; i++) {
+        packet.moves[i] = net->local_moves[(packet.first + i) % NET_HISTORY];
+    }
+    int synced = net->remote_received < net->tick ? net->remote_received : net->tick;
+    if (synced > 0) {
+        packet.synced = synced;
+        packet.sync_hash = hash_game(net_state_after(net, synced - 1));
+    }
+
+    net->packets_sent++;
+    if ((int)(next_random(&net->loss_state) % 100) < net->loss_percent || net->queue_count == NET_QUEUE) {
+        net->packets_lost++;
+        return;
+    }
+    DelayedPacket *delayed = &net->queue[(net->queue_head + net->queue_count) % NET_QUEUE];
+    delayed->due = seconds_now() + net->delay_ms / 1000.0;
+    delayed->packet = packet;
+    net->queue_count++;
+}
+
+// Put packets whose injected delay has passed on the socket
+void net_flush(NetSession *net) {
+    double now = seconds_now();
+    while (net->queue_count > 0 && net->queue[net->queue_head].due <= now) {
+        if (send(net->fd, &net->queue[net->queue_head].packet, sizeof(NetPacket),
+                 MSG_DONTWAIT | MSG_NOSIGNAL) < 0) {
+            net->packets_lost++;
+        }
+        net->queue_head = (net->queue_head + 1) % NET_QUEUE;
+        net->queue_count--;
+    }
+}
+
+void net_handle_packet(NetSession *net, const NetPacket *packet) {
+    net->packets_received++;
+    if (packet->quit) {
+        net->remote_quit = true;
+    }
+    if (packet->tick > net->remote_tick) {
+        net->remote_tick = packet->tick;
+        net->remote_advantage = packet->advantage;
+    }
+    if (packet->ack > net->local_acked && packet->ack <= net->tick) {
+        net->rtt_last = seconds_now() - net->sent_at[(packet->ack - 1) % NET_HISTORY];
+        net->rtt_total += net->rtt_last;
+        net->rtt_samples++;
+        net->local_acked = packet->ack;
+    }
+
+    // Take the next inputs in order; earlier ones are repeats
+    for (int i = 0; i < packet->count && i < NET_SEND_WINDOW; i++) {
+        int tick = packet->first + i;
+        if (tick != net->remote_received) {
+            continue;
+        }
+        net->remote_moves[tick % NET_HISTORY] = packet->moves[i];
+        if (tick < net->tick && packet->moves[i] != 0 && tick < net->rollback_from) {
+            net->rollback_from = tick; // Run with a guess of no move
+        }
+        net->remote_received++;
+    }
+
+    if (packet->synced > net->peer_synced) {
+        net->peer_synced = packet->synced;
+        net->peer_hash = packet->sync_hash;
+    }
+}
+
+// Take every packet that has arrived, then roll back and replay from the
+// earliest wrong guess and check the other side agrees on the result
+void net_receive(NetSession *net) {
+    NetPacket packet;
+    ssize_t size;
+    while ((size = recv(net->fd, &packet, sizeof(packet), MSG_DONTWAIT)) != 0) {
+        if (size < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) net->remote_quit = true;
             break;
+        }
+        if (size == sizeof(packet)) {
+            net_handle_packet(net, &packet);
+        }
+    }
+    if (size == 0) {
+        net->remote_quit = true; // The other process has gone
+    }
+
+    if (net->rollback_from < net->tick) {
+        int replayed = net->tick - net->rollback_from;
+        net->game = net->snapshots[net->rollback_from % NET_HISTORY];
+        for (int tick = net->rollback_from; tick < net->tick; tick++) {
+            net_simulate(net, tick);
+        }
+        net->rollback_from = net->tick;
+        net->rollbacks++;
+        net->resimulated += replayed;
+        if (replayed > net->resimulated_max) net->resimulated_max = replayed;
+    }
+
+    // Only states both sides have every input for, and that are still kept
+    int tick = net->peer_synced - 1;
+    if (tick >= 0 && tick < net->remote_received && tick < net->tick &&
+        net->tick - tick < NET_ROLLBACK_TICKS) {
+        net->sync_checks++;
+        if (hash_game(net_state_after(net, tick)) != net->peer_hash) {
+            net->desyncs++;
+        }
+        net->peer_synced = 0;
+    }
+}
+
+// Ticks this side should drop to stay level with the other; both measure
+// how far ahead they are including the link delay, so the difference of
+// the two halves is the real lead
+int net_ticks_ahead(NetSession *net) {
+    if (net->since_sync < NET_SYNC_INTERVAL) {
+        return 0;
+    }
+    int ahead = ((net->tick - net->remote_tick) - net->remote_advantage) / 2;
+    return ahead > 1 ? ahead : 0; // A tick either way is just when packets were flushed
+}
+
+void net_send_quit(NetSession *net) {
+    NetPacket packet;
+    memset(&packet, 0, sizeof(packet));
+    packet.tick = net->tick;
+    packet.quit = 1;
+    send(net->fd, &packet, sizeof(packet), MSG_DONTWAIT | MSG_NOSIGNAL);
+}
+
+// Connect the two processes and agree on the seed and court size. The host
+// creates the socket and waits; the other side retries until it appears.
+bool net_connect(NetSession *net, bool host, const char *path) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        return false;
+    }
+    strcpy(address.sun_path, path);
+
+    NetHello hello;
+    if (host) {
+        int listener = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+        if (listener < 0) {
+            return false;
+        }
+        unlink(path);
+        if (bind(listener, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(listener, 1) < 0) {
+            close(listener);
+            return false;
+        }
+        frame_begin();
+        frame_print(LINES / 2, 2, 0, "Waiting for the other player on %s", path);
+        frame_present();
+        net->fd = accept(listener, NULL, NULL);
+        close(listener);
+        unlink(path);
+        if (net->fd < 0) {
+            return false;
+        }
+        hello.seed = time(NULL);
+        hello.width = COLS;
+        hello.height = LINES;
+        if (send(net->fd, &hello, sizeof(hello), MSG_NOSIGNAL) != sizeof(hello)) {
+            return false;
+        }
+    } else {
+        net->fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+        if (net->fd < 0) {
+            return false;
+        }
+        int tries = 0;
+        while (connect(net->fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+            if (++tries == NET_CONNECT_TRIES) {
+                return false;
+            }
+            usleep(100000);
+        }
+        if (recv(net->fd, &hello, sizeof(hello), 0) != sizeof(hello)) {
+            return false;
+        }
+    }
+    init_game(&net->game, hello.width, hello.height, hello.seed);
+    return true;
+}
+
+void net_report(NetSession *net, FILE *out) {
+    fprintf(out, "Net: ticks %d  rollbacks %ld  replayed ticks avg %.1f max %d  stalls %ld  "
+            "skipped %ld\n",
+            net->tick, net->rollbacks, net->rollbacks ? (double)net->resimulated / net->rollbacks : 0.0,
+            net->resimulated_max, net->stalls, net->skipped);
+    fprintf(out, "     packets sent %ld  lost %ld  received %ld  round trip avg %.1f ms  "
+            "sync checks %ld  desyncs %ld\n",
+            net->packets_sent, net->packets_lost, net->packets_received,
+            net->rtt_samples ? net->rtt_total / net->rtt_samples * 1000 : 0.0,
+            net->sync_checks, net->desyncs);
+}
+
+// Play one paddle against another process: the host on the left, the
+// other side on the right. Both use W/S or the arrow keys.
+int run_net_mode(bool host, const char *path, int delay_ms, int loss_percent) {
+    if (!runtime_init(&runtime, 1000000 / PHYSICS_HZ)) {
+        fprintf(stderr, "Could not create the tick timer\n");
+        return 1;
+    }
+    NetSession *net = calloc(1, sizeof(NetSession));
+    net->host = host;
+    net->delay_ms = delay_ms;
+    net->loss_percent = loss_percent;
+    net->loss_state = time(NULL) ^ getpid();
+
+    frame_init();
+    cbreak();
+    noecho();
+    keypad(stdscr, TRUE);
+    curs_set(0);
+    start_color();
+    init_pair(1, COLOR_YELLOW, COLOR_BLACK); // For powerups
+
+    if (!net_connect(net, host, path)) {
+        frame_end();
+        fprintf(stderr, "Could not %s %s\n", host ? "listen on" : "connect to", path);
+        free(net);
+        runtime_close(&runtime);
+        return 1;
+    }
+    nodelay(stdscr, TRUE);
+    runtime_restart(&runtime); // Tick 0 is now on both sides
+    int moves = 0;
+    long last_drawn = -PHYSICS_HZ;
+
+    while (!game_over && !net->remote_quit) {
+        int ticks = runtime_wait(&runtime);
+
+        int ch;
+        while ((ch = getch()) != ERR) {
+            if (ch == 'q' || ch == 'Q') {
+                game_over = true;
+            } else if (ch == 'w' || ch == 'W' || ch == KEY_UP) {
+                moves--;
+            } else if (ch == 's' || ch == 'S' || ch == KEY_DOWN) {
+                moves++;
+            }
+        }
+
+        net_receive(net);
+        if (ticks > 0 && net_ticks_ahead(net) > 0) {
+            ticks--;
+            net->skipped++;
+            net->since_sync = 0;
+        }
+        bool moved = false;
+        for (int i = 0; i < ticks; i++) {
+            if (net_advance(net, moves)) {
+                moved = moved || moves != 0;
+                moves = 0;
+            }
+        }
+        if (ticks > 0) {
+            net_send(net);
+        }
+        net_flush(net);
+
+        // Draw at FRAME_HZ, or straight away once the local player's move has run
+        if (!moved && net->game.steps - last_drawn < PHYSICS_HZ / FRAME_HZ) {
+            continue;
+        }
+        last_drawn = net->game.steps;
+
+        frame_begin();
+        draw_border();
+        draw_ball(&net->game.ball);
+        draw_paddle(&net->game.player);
+        draw_paddle(&net->game.opponent);
+        draw_powerup(&net->game.powerup);
+        draw_scores(&net->game);
+        if (net->stalled) {
+            frame_print(LINES / 2, COLS / 2 - 16, 0, "Waiting for the other player...");
+        }
+        frame_print(LINES - 2, 2, 0, "Q: Quit | W/S: Move %s paddle | round trip %.0f ms",
+                    host ? "left" : "right", net->rtt_last * 1000);
+        frame_present();
+    }
+
+    net_send_quit(net);
+    close(net->fd);
+    frame_end();
+    runtime_report(&runtime, stderr);
+    net_report(net, stderr);
+    runtime_close(&runtime);
+    free(net);
+    return 0;
+}
+
+// Many balls and power-ups on a court much larger than the screen, to load
+// the simulation and renderer. Balls are kept as arrays of the same fixed
+// point fields as Ball, and each carries its own speed boost. Each side has
+// a column of paddles, one per STRESS_PADDLE_SPACING rows, found for a row
+// through a row table. Power-ups are bucketed in a uniform grid, so a ball
+// only looks at the few in the grid cells it touches.
+typedef struct {
+    int width, height;
+    int ball_count;
+    int *fx, *fy;           // Balls' centers, fixed point
+    int *vx, *vy;           // Per physics step, fixed point
+    int *boost;             // Steps left at double speed
+    int paddle_count;       // Per side
+    Paddle *paddles[2];     // Left then right
+    int *paddle_dir[2];
+    int *paddle_at_row[2];  // Index of the paddle covering a row, or -1
+    int powerup_count;
+    PowerUp *powerups;
+    int grid_width, grid_height;
+    int *grid_start;        // Power-ups in grid cell c are grid_items[grid_start[c]..grid_start[c + 1]]
+    int *grid_items;
+    bool grid_dirty;
+    int scores[2];
+    long steps;
+    unsigned int rng_state;
+    // Statistics
+    long paddle_hits;
+    long powerups_taken;
+    long powerup_checks;
+    long points;
+} StressCourt;
+
+// Scaled-down picture of the court, one character per screen cell
+typedef struct {
+    int cols, rows;
+    int *counts;
+    char *text;
+} StressView;
+
+// Serve ball i from the middle of a random row, at speeds that cross the
+// court in a few seconds whatever its size
+void stress_launch(StressCourt *court, int i) {
+    unsigned int *rng = &court->rng_state;
+    int speed = court->width * FIXED_ONE / (PHYSICS_HZ * 8);
+    court->fx[i] = to_fixed(court->width / 2);
+    court->fy[i] = to_fixed(next_random(rng) % (court->height - 2) + 1);
+    court->vx[i] = (speed + next_random(rng) % speed) * ((next_random(rng) % 2) ? 1 : -1);
+    court->vy[i] = (int)((long long)court->vx[i] * ((int)(next_random(rng) % 201) - 100) / 100);
+    court->boost[i] = 0;
+}
+
+void stress_place_powerup(StressCourt *court, PowerUp *powerup) {
+    powerup->x = next_random(&court->rng_state) % (court->width - 8) + 4;
+    powerup->y = next_random(&court->rng_state) % (court->height - 4) + 2;
+    powerup->type = next_random(&court->rng_state) % 3 + 1;
+    powerup->active = true;
+    powerup->spawn_step = court->steps;
+}
+
+// Replace taken power-ups and rebuild the grid by counting sort
+void stress_build_grid(StressCourt *court) {
+    int cells = court->grid_width * court->grid_height;
+    memset(court->grid_start, 0, (cells + 1) * sizeof(int));
+    for (int p = 0; p < court->powerup_count; p++) {
+        PowerUp *powerup = &court->powerups[p];
+        if (!powerup->active) {
+            stress_place_powerup(court, powerup);
+        }
+        court->grid_start[(powerup->y / STRESS_GRID) * court->grid_width + powerup->x / STRESS_GRID + 1]++;
+    }
+    for (int c = 0; c < cells; c++) {
+        court->grid_start[c + 1] += court->grid_start[c];
+    }
+    for (int p = 0; p < court->powerup_count; p++) {
+        PowerUp *powerup = &court->powerups[p];
+        int c = (powerup->y / STRESS_GRID) * court->grid_width + powerup->x / STRESS_GRID;
+        court->grid_items[court->grid_start[c]++] = p;
+    }
+    // The fill moved each start to the next cell's; shift them back
+    for (int c = cells; c > 0; c--) {
+        court->grid_start[c] = court->grid_start[c - 1];
+    }
+    court->grid_start[0] = 0;
+    court->grid_dirty = false;
+}
+
+void stress_build_rows(StressCourt *court) {
+    for (int side = 0; side < 2; side++) {
+        memset(court->paddle_at_row[side], -1, court->height * sizeof(int));
+        for (int k = 0; k < court->paddle_count; k++) {
+            Paddle *paddle = &court->paddles[side][k];
+            for (int i = 0; i < paddle->size; i++) {
+                court->paddle_at_row[side][paddle->y + i] = k;
+            }
+        }
+    }
+}
+
+// Rows paddle k of a side may use
+int stress_slot_top(int k) {
+    return 1 + k * STRESS_PADDLE_SPACING;
+}
+
+// Sweep every paddle up and down its own stretch of the side, one row per
+// logic tick
+void stress_move_paddles(StressCourt *court) {
+    for (int side = 0; side < 2; side++) {
+        for (int k = 0; k < court->paddle_count; k++) {
+            Paddle *paddle = &court->paddles[side][k];
+            int *dir = &court->paddle_dir[side][k];
+            int top = stress_slot_top(k);
+            int bottom = top + STRESS_PADDLE_SPACING - paddle->size;
+            if ((*dir < 0 && paddle->y <= top) || (*dir > 0 && paddle->y >= bottom)) {
+                *dir = -*dir;
+            }
+            paddle->y += *dir;
+        }
+    }
+    stress_build_rows(court);
+}
+
+void init_stress(StressCourt *court, int balls, int powerups, int width, int height,
+                 unsigned int seed) {
+    memset(court, 0, sizeof(*court));
+    court->width = width;
+    court->height = height;
+    court->rng_state = seed;
+    court->ball_count = balls;
+    court->fx = malloc(balls * sizeof(int));
+    court->fy = malloc(balls * sizeof(int));
+    court->vx = malloc(balls * sizeof(int));
+    court->vy = malloc(balls * sizeof(int));
+    court->boost = malloc(balls * sizeof(int));
+    for (int i = 0; i < balls; i++) {
+        stress_launch(court, i);
+    }
+
+    court->paddle_count = (height - 2) / STRESS_PADDLE_SPACING;
+    for (int side = 0; side < 2; side++) {
+        court->paddles[side] = malloc(court->paddle_count * sizeof(Paddle));
+        court->paddle_dir[side] = malloc(court->paddle_count * sizeof(int));
+        court->paddle_at_row[side] = malloc(height * sizeof(int));
+        for (int k = 0; k < court->paddle_count; k++) {
+            Paddle *paddle = &court->paddles[side][k];
+            paddle->size = INITIAL_PADDLE_SIZE;
+            paddle->x = side == 0 ? 2 : width - 3;
+            paddle->original_y = stress_slot_top(k) + next_random(&court->rng_state) %
+                                 (STRESS_PADDLE_SPACING - INITIAL_PADDLE_SIZE);
+            paddle->y = paddle->original_y;
+            court->paddle_dir[side][k] = (next_random(&court->rng_state) % 2) ? 1 : -1;
+        }
+    }
+    stress_build_rows(court);
+
+    court->powerup_count = powerups;
+    court->powerups = calloc(powerups, sizeof(PowerUp));
+    court->grid_width = width / STRESS_GRID + 1;
+    court->grid_height = height / STRESS_GRID + 1;
+    court->grid_start = malloc((court->grid_width * court->grid_height + 1) * sizeof(int));
+    court->grid_items = malloc(powerups * sizeof(int));
+    stress_build_grid(court);
+}
+
+void free_stress(StressCourt *court) {
+    free(court->fx);
+    free(court->fy);
+    free(court->vx);
+    free(court->vy);
+    free(court->boost);
+    for (int side = 0; side < 2; side++) {
+        free(court->paddles[side]);
+        free(court->paddle_dir[side]);
+        free(court->paddle_at_row[side]);
+    }
+    free(court->powerups);
+    free(court->grid_start);
+    free(court->grid_items);
+}
+
+// Apply the power-ups within a cell of ball i, looking only in the grid
+// cells its neighbourhood overlaps
+void stress_check_powerups(StressCourt *court, int i) {
+    int x = to_cell(court->fx[i]);
+    int y = to_cell(court->fy[i]);
+    int side = x < court->width / 2 ? 0 : 1;
+    for (int gy = (y - 1) / STRESS_GRID; gy <= (y + 1) / STRESS_GRID; gy++) {
+        for (int gx = (x - 1) / STRESS_GRID; gx <= (x + 1) / STRESS_GRID; gx++) {
+            int c = gy * court->grid_width + gx;
+            for (int j = court->grid_start[c]; j < court->grid_start[c + 1]; j++) {
+                PowerUp *powerup = &court->powerups[court->grid_items[j]];
+                court->powerup_checks++;
+                if (!powerup->active || x < powerup->x - 1 || x > powerup->x + 1 ||
+                    y < powerup->y - 1 || y > powerup->y + 1) {
+                    continue;
+                }
+                switch (powerup->type) {
+                    case 1: { // Enlarge the paddle guarding this stretch of the ball's side
+                        int k = (y - 1) / STRESS_PADDLE_SPACING;
+                        if (k >= court->paddle_count) k = court->paddle_count - 1;
+                        Paddle *paddle = &court->paddles[side][k];
+                        if (paddle->size < 8) {
+                            paddle->size += 2;
+                            int bottom = stress_slot_top(k) + STRESS_PADDLE_SPACING - paddle->size;
+                            if (paddle->y > bottom) paddle->y = bottom;
+                            stress_build_rows(court);
+                        }
+                        break;
+                    }
+                    case 2: // Speed boost, for this ball only
+                        court->boost[i] = SPEED_BOOST_STEPS;
+                        break;
+                    case 3: // Extra points
+                        court->scores[side] += 2;
+                        break;
+                }
+                powerup->active = false;
+                court->powerups_taken++;
+                court->grid_dirty = true;
+            }
+        }
+    }
+}
+
+// move_ball for ball i: swept against the paddle face it moves towards,
+// with the paddle found from the row table
+void stress_move_ball(StressCourt *court, int i) {
+    int low = to_fixed(1);
+    int high = to_fixed(court->height - 2);
+    int x0 = court->fx[i];
+    int x1 = x0 + court->vx[i];
+    int start_y = court->fy[i];
+    long long remaining = 1;
+    long long whole = 1;
+
+    int side = court->vx[i] < 0 ? 0 : 1;
+    int face = to_fixed(side == 0 ? 3 : court->width - 4);
+    bool crosses = side == 0 ? (x0 >= face && x1 < face) : (x0 <= face && x1 > face);
+    if (crosses) {
+        long long travelled = face - x0;
+        long long step = x1 - x0;
+        bool flipped;
+        int hit_y = fold(court->fy[i] + (int)(court->vy[i] * travelled / step), low, high, &flipped);
+        int k = court->paddle_at_row[side][to_cell(hit_y)];
+        if (k >= 0) {
+            Paddle *paddle = &court->paddles[side][k];
+            x1 = 2 * face - x1;
+            court->vx[i] = -court->vx[i];
+
+            // Same bounce angles as move_ball, relative to this ball's speed
+            int center = to_fixed(paddle->y) + to_fixed(paddle->size - 1) / 2;
+            int half = to_fixed(paddle->size) / 2;
+            long long max_vy = (long long)abs(court->vx[i]) * BALL_MAX_VY / BALL_SPEED;
+            long long vy = max_vy * (hit_y - center) / half;
+            if (vy > max_vy) vy = max_vy;
+            if (vy < -max_vy) vy = -max_vy;
+            court->vy[i] = (int)vy;
+
+            start_y = hit_y;
+            remaining = step - travelled;
+            whole = step;
+            court->paddle_hits++;
+        }
+    }
+
+    bool flipped;
+    court->fy[i] = fold(start_y + (int)(court->vy[i] * remaining / whole), low, high, &flipped);
+    if (flipped) {
+        court->vy[i] = -court->vy[i];
+    }
+    court->fx[i] = x1;
+
+    int x = to_cell(x1);
+    if (x <= 1 || x >= court->width - 2) {
+        court->scores[x <= 1 ? 1 : 0]++;
+        court->points++;
+        stress_launch(court, i);
+    }
+}
+
+void step_stress(StressCourt *court) {
+    court->steps++;
+    if (court->steps % (PHYSICS_HZ / LOGIC_HZ) == 0) {
+        stress_move_paddles(court);
+    }
+    for (int i = 0; i < court->ball_count; i++) {
+        for (int pass = 0; pass < (court->boost[i] > 0 ? 2 : 1); pass++) {
+            stress_move_ball(court, i);
+            stress_check_powerups(court, i);
+        }
+        if (court->boost[i] > 0) {
+            court->boost[i]--;
+        }
+    }
+    if (court->grid_dirty) {
+        stress_build_grid(court);
     }
 }
 
-int main() {
+void init_stress_view(StressView *view, int cols, int rows) {
+    view->cols = cols;
+    view->rows = rows;
+    view->counts = malloc(cols * rows * sizeof(int));
+    view->text = malloc(rows * (cols + 1));
+}
+
+void free_stress_view(StressView *view) {
+    free(view->counts);
+    free(view->text);
+}
+
+// Scale the court down into the view: '.', 'o' and 'O' for more balls per
+// screen cell, '|' for paddles
+void rasterize_stress(StressCourt *court, StressView *view) {
+    memset(view->counts, 0, view->cols * view->rows * sizeof(int));
+    for (int i = 0; i < court->ball_count; i++) {
+        int col = (int)((long long)court->fx[i] * view->cols / to_fixed(court->width));
+        int row = (int)((long long)court->fy[i] * view->rows / to_fixed(court->height));
+        if (col >= 0 && col < view->cols && row >= 0 && row < view->rows) {
+            view->counts[row * view->cols + col]++;
+        }
+    }
+    for (int row = 0; row < view->rows; row++) {
+        char *line = view->text + row * (view->cols + 1);
+        for (int col = 0; col < view->cols; col++) {
+            int count = view->counts[row * view->cols + col];
+            line[col] = count == 0 ? ' ' : count == 1 ? '.' : count < 5 ? 'o' : 'O';
+        }
+        line[view->cols] = '\0';
+    }
+    for (int side = 0; side < 2; side++) {
+        int col = side == 0 ? 0 : view->cols - 1;
+        for (int k = 0; k < court->paddle_count; k++) {
+            Paddle *paddle = &court->paddles[side][k];
+            for (int i = 0; i < paddle->size; i++) {
+                int row = (paddle->y + i) * view->rows / court->height;
+                view->text[row * (view->cols + 1) + col] = '|';
+            }
+        }
+    }
+}
+
+void draw_stress(StressCourt *court, StressView *view) {
+    for (int row = 0; row < view->rows; row++) {
+        frame_print(row + 1, 1, 0, "%s", view->text + row * (view->cols + 1));
+    }
+    for (int p = 0; p < court->powerup_count; p++) {
+        PowerUp *powerup = &court->powerups[p];
+        int col = powerup->x * view->cols / court->width;
+        int row = powerup->y * view->rows / court->height;
+        if (view->counts[row * view->cols + col] == 0) {
+            frame_print(row + 1, col + 1, 1, "%c", "ESP"[powerup->type - 1]);
+        }
+    }
+}
+
+uint32_t hash_stress(StressCourt *court) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < court->ball_count; i++) {
+        hash = (hash ^ (uint32_t)court->fx[i]) * 16777619u;
+        hash = (hash ^ (uint32_t)court->fy[i]) * 16777619u;
+    }
+    hash = (hash ^ (uint32_t)court->scores[0]) * 16777619u;
+    return (hash ^ (uint32_t)court->scores[1]) * 16777619u;
+}
+
+// Headless: ms per physics tick and per rasterized frame against ball count
+void run_stress_bench(int ticks, int powerups, int width, int height) {
+    const int counts[] = { 250, 1000, 4000, 16000, 64000 };
+    printf("%d ticks on a %dx%d court, %d power-ups, %d paddles a side\n",
+           ticks, width, height, powerups, (height - 2) / STRESS_PADDLE_SPACING);
+    for (int c = 0; c < 5; c++) {
+        StressCourt court;
+        StressView view;
+        init_stress(&court, counts[c], powerups, width, height, 1);
+        init_stress_view(&view, 78, 21);
+
+        double start = seconds_now();
+        for (int t = 0; t < ticks; t++) {
+            step_stress(&court);
+        }
+        double simulate = seconds_now() - start;
+        start = seconds_now();
+        int frames = ticks / (PHYSICS_HZ / FRAME_HZ);
+        for (int f = 0; f < frames; f++) {
+            rasterize_stress(&court, &view);
+        }
+        double raster = seconds_now() - start;
+
+        long moves = court.ball_count * (long)ticks;
+        printf("%6d balls: %7.3f ms/tick  %5.1f ns/ball  raster %6.3f ms/frame  "
+               "power-up checks/ball %.2f  hits %ld  power-ups %ld  points %ld  checksum %08x\n",
+               counts[c], simulate * 1000 / ticks, simulate * 1e9 / moves, raster * 1000 / frames,
+               (double)court.powerup_checks / moves, court.paddle_hits, court.powerups_taken,
+               court.points, hash_stress(&court));
+        free_stress_view(&view);
+        free_stress(&court);
+    }
+}
+
+// Watch the stress court scaled down to the terminal, with its timings
+int run_stress_mode(int balls, int powerups, int width, int height) {
+    if (!runtime_init(&runtime, 1000000 / PHYSICS_HZ)) {
+        fprintf(stderr, "Could not create the tick timer\n");
+        return 1;
+    }
+    frame_init();
+    cbreak();
+    noecho();
+    keypad(stdscr, TRUE);
+    curs_set(0);
+    nodelay(stdscr, TRUE);
+    start_color();
+    init_pair(1, COLOR_YELLOW, COLOR_BLACK); // For powerups
+
+    StressCourt court;
+    StressView view;
+    init_stress(&court, balls, powerups, width, height, time(NULL));
+    init_stress_view(&view, COLS - 2, LINES - 3);
+    double simulate = 0, draw = 0;
+    long frames = 0;
+    long last_drawn = -PHYSICS_HZ;
+
+    while (!game_over) {
+        int ticks = runtime_wait(&runtime);
+        int ch;
+        while ((ch = getch()) != ERR) {
+            if (ch == 'q' || ch == 'Q') {
+                game_over = true;
+            }
+        }
+
+        double start = seconds_now();
+        for (int i = 0; i < ticks; i++) {
+            step_stress(&court);
+        }
+        simulate += seconds_now() - start;
+        if (court.steps - last_drawn < PHYSICS_HZ / FRAME_HZ) {
+            continue;
+        }
+        last_drawn = court.steps;
+
+        start = seconds_now();
+        if (view.cols != COLS - 2 || view.rows != LINES - 3) {
+            free_stress_view(&view);
+            init_stress_view(&view, COLS - 2, LINES - 3);
+        }
+        frame_begin();
+        draw_border();
+        rasterize_stress(&court, &view);
+        draw_stress(&court, &view);
+        frame_print(LINES - 1, 2, 0, " %d balls | %.3f ms/tick | %.3f ms/frame | %d - %d | Q: Quit ",
+                    court.ball_count, court.steps ? simulate * 1000 / court.steps : 0.0,
+                    frames ? draw * 1000 / frames : 0.0, court.scores[0], court.scores[1]);
+        frame_present();
+        draw += seconds_now() - start;
+        frames++;
+    }
+
+    frame_end();
+    runtime_report(&runtime, stderr);
+    fprintf(stderr, "Stress: %d balls  %d power-ups  %.3f ms/tick  %.3f ms/frame\n",
+            court.ball_count, court.powerup_count, court.steps ? simulate * 1000 / court.steps : 0.0,
+            frames ? draw * 1000 / frames : 0.0);
+    free_stress_view(&view);
+    free_stress(&court);
+    runtime_close(&runtime);
+    return 0;
+}
+
+void print_usage(const char *program) {
+    printf("Usage: %s [--latency]\n", program);
+    printf("       %s --sim [matches] [threads] [seed] [left-ms left-error right-ms right-error]\n",
+           program);
+    printf("       %s --host|--join [socket] [delay-ms] [loss-percent]\n", program);
+    printf("       %s --stress [balls] [power-ups] [width height]\n", program);
+    printf("       %s --stress-bench [ticks] [power-ups] [width height]\n", program);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && strcmp(argv[1], "--sim") == 0) {
+        int matches = argc > 2 ? atoi(argv[2]) : SIM_MATCHES;
+        int thread_count = argc > 3 ? atoi(argv[3]) : 0;
+        unsigned int seed = argc > 4 ? (unsigned int)strtoul(argv[4], NULL, 10) : 1;
+        AISettings left, right;
+        // The AI settings come as all four values or not at all
+        bool pairing = argc == 9;
+        if (pairing) {
+            left.reaction_ms = atoi(argv[5]);
+            left.error = (float)atof(argv[6]);
+            right.reaction_ms = atoi(argv[7]);
+            right.error = (float)atof(argv[8]);
+        }
+        if (matches < 1 || (argc > 5 && !pairing)) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        run_sim_mode(matches, thread_count, seed, pairing ? &left : NULL, pairing ? &right : NULL);
+        return 0;
+    }
+    if (argc > 1 && (strcmp(argv[1], "--host") == 0 || strcmp(argv[1], "--join") == 0)) {
+        const char *path = argc > 2 ? argv[2] : NET_SOCKET;
+        int delay_ms = argc > 3 ? atoi(argv[3]) : 0;
+        int loss_percent = argc > 4 ? atoi(argv[4]) : 0;
+        return run_net_mode(strcmp(argv[1], "--host") == 0, path, delay_ms, loss_percent);
+    }
+    if (argc > 1 && (strcmp(argv[1], "--stress") == 0 || strcmp(argv[1], "--stress-bench") == 0)) {
+        bool bench = strcmp(argv[1], "--stress-bench") == 0;
+        int count = argc > 2 ? atoi(argv[2]) : bench ? STRESS_TICKS : STRESS_BALLS;
+        int powerups = argc > 3 ? atoi(argv[3]) : STRESS_POWERUPS;
+        int width = argc > 5 ? atoi(argv[4]) : STRESS_WIDTH;
+        int height = argc > 5 ? atoi(argv[5]) : STRESS_HEIGHT;
+        if (count < 1 || powerups < 0 || width < 40 || width > 16000 ||
+            height < STRESS_PADDLE_SPACING + 2 || height > 16000) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        if (bench) {
+            run_stress_bench(count, powerups, width, height);
+            return 0;
+        }
+        return run_stress_mode(count, powerups, width, height);
+    }
+    bool show_latency = argc > 1 && strcmp(argv[1], "--latency") == 0;
+    if (argc > 1 && !show_latency) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    if (!runtime_init(&runtime, 1000000 / PHYSICS_HZ)) {
+        fprintf(stderr, "Could not create the tick timer\n");
+        return 1;
+    }
+
     // Initialize ncurses
-    initscr();
+    frame_init();
     cbreak();
     noecho();
     keypad(stdscr, TRUE);
     curs_set(0);
     nodelay(stdscr, TRUE);
-    
+
     // Initialize colors
     start_color();
     init_pair(1, COLOR_YELLOW, COLOR_BLACK); // For powerups
-    
+
     // Initialize game objects
-    Ball ball;
-    Paddle player, opponent;
-    PowerUp powerup;
-    
-    init_ball(&ball);
-    init_paddle(&player, 2);
-    init_paddle(&opponent, COLS - 3);
-    init_powerup(&powerup);
-    
-    // Ball direction (1 or -1 for x and y)
-    int ball_dir_x = (rand() % 2) ? 1 : -1;
-    int ball_dir_y = (rand() % 2) ? 1 : -1;
-    
-    // Seed random number generator
-    srand(time(NULL));
-    
+    PongGame game;
+    init_game(&game, COLS, LINES, time(NULL));
+    init_paddle_ai(&game.opponent_ai, game_mode == 1, AI_REACTION_MS, AI_ERROR);
+    long last_drawn = -PHYSICS_HZ;
+
     // Main game loop
     while (!game_over) {
-        // Handle input
-        int ch = getch();
-        handle_input(ch, &player, &opponent, &ball, &ball_dir_x, &ball_dir_y);
-        
-        // AI movement in single player mode
-        if (game_mode == 1) {
-            move_ai_paddle(&opponent, &ball, ball_dir_x);
-        }
-        
-        // Move ball
-        move_ball(&ball, &ball_dir_x, &ball_dir_y, &player, &opponent);
-        
-        // Handle powerups
-        spawn_powerup(&powerup, &ball);
-        check_powerup_collision(&powerup, &ball, &player, &opponent);
-        
-        // Decrease speed boost over time
-        if (speed_boost > 0) {
-            speed_boost--;
-            if (speed_boost == 0) {
-                ball_delay = BALL_DELAY;
+        // Sleep until a key arrives or the ball is due to move
+        int ticks = runtime_wait(&runtime);
+        game.height = LINES; // Follow the terminal if it is resized
+        game.width = COLS;
+
+        // Apply every key waiting, in order, so held and simultaneous keys
+        // never queue up behind frames
+        InputEvent event;
+        event.woken = runtime.woken;
+        bool pressed = false;
+        while ((event.key = getch()) != ERR) {
+            input_applied(&wake_latency, &event);
+            handle_input(&game, event.key);
+            if (event.key == 'p' || event.key == 'P') {
+                clock_gettime(CLOCK_MONOTONIC, &event.woken); // Later keys came during the pause
             }
+            pressed = true;
+        }
+
+        for (int i = 0; i < ticks && !game_over; i++) {
+            step_game(&game);
+        }
+
+        // Draw at FRAME_HZ, or straight away when a key changed something
+        if (!pressed && game.steps - last_drawn < PHYSICS_HZ / FRAME_HZ) {
+            continue;
         }
-        
+        last_drawn = game.steps;
+
         // Draw everything
-        clear();
+        frame_begin();
         draw_border();
-        draw_ball(&ball);
-        draw_paddle(&player);
-        draw_paddle(&opponent);
-        draw_powerup(&powerup);
-        draw_scores();
+        draw_ball(&game.ball);
+        draw_paddle(&game.player);
+        draw_paddle(&game.opponent);
+        draw_powerup(&game.powerup);
+        draw_scores(&game);
         draw_instructions();
-        
-        refresh();
-        usleep(ball_delay);
+        if (show_latency) {
+            frame_print(LINES - 1, 2, 0, " Wake to frame: p50 %.2f ms  p99 %.2f ms ",
+                        wake_latency_percentile_us(&wake_latency, 0.50) / 1000.0,
+                        wake_latency_percentile_us(&wake_latency, 0.99) / 1000.0);
+        }
+
+        frame_present();
+        input_presented(&wake_latency);
     }
-    
+
     // Clean up
-    endwin();
+    frame_end();
+    runtime_report(&runtime, stderr);
+    if (show_latency) {
+        wake_latency_report(&wake_latency, stderr);
+    }
+    runtime_close(&runtime);
     return 0;
 }
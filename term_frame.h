@@ -0,0 +1,232 @@
+// Double-buffered cell framebuffer shared by the ncurses games.
+//
+// Games draw a whole frame into the back buffer with frame_print, then
+// frame_present compares it with the previous frame and writes only the
+// changed cells, as terminfo escape sequences, to the terminal in a single
+// write(). ncurses is still used for terminal setup and keyboard input, but
+// never for drawing, so the bytes written per frame are known exactly.
+#ifndef TERM_FRAME_H
+#define TERM_FRAME_H
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <ncurses.h>
+
+// One character per cell: an ASCII byte or a whole UTF-8 sequence, padded
+// with zero bytes
+typedef struct {
+    char ch[4];
+    unsigned char pair;
+} FrameCell;
+
+static const FrameCell FRAME_BLANK = { { ' ' }, 0 };
+
+typedef struct {
+    int width;
+    int height;
+    FrameCell *front;  // What the terminal currently shows
+    FrameCell *back;   // Frame being drawn
+    bool full_redraw;
+    // Output batch for one frame
+    char *output;
+    size_t output_length;
+    size_t output_capacity;
+    int cursor_y;
+    int cursor_x;
+    int pair;          // Color pair currently set on the terminal, -1 if unknown
+    // Statistics
+    long frames;
+    long cells_sent;
+    size_t bytes_total;
+    size_t bytes_last;
+    size_t bytes_max;
+    long writes;
+} Frame;
+
+static Frame frame;
+
+static void frame_append(const char *data, size_t size) {
+    if (frame.output_length + size > frame.output_capacity) {
+        while (frame.output_length + size > frame.output_capacity) {
+            frame.output_capacity = frame.output_capacity ? frame.output_capacity * 2 : 4096;
+        }
+        frame.output = realloc(frame.output, frame.output_capacity);
+    }
+    memcpy(frame.output + frame.output_length, data, size);
+    frame.output_length += size;
+}
+
+// Append a terminfo capability, ignoring ones the terminal lacks
+static void frame_append_cap(const char *cap) {
+    if (cap && cap != (char *)-1) {
+        frame_append(cap, strlen(cap));
+    }
+}
+
+static void frame_set_pair(int pair) {
+    if (pair == frame.pair) {
+        return;
+    }
+    frame_append_cap(tigetstr("sgr0"));
+    if (pair != 0 && has_colors()) {
+        short fg, bg;
+        pair_content(pair, &fg, &bg);
+        frame_append_cap(tiparm(tigetstr("setaf"), fg));
+        frame_append_cap(tiparm(tigetstr("setab"), bg));
+    }
+    frame.pair = pair;
+}
+
+static void frame_resize(void) {
+    frame.width = COLS;
+    frame.height = LINES;
+    size_t cells = (size_t)frame.width * frame.height;
+    frame.front = realloc(frame.front, cells * sizeof(FrameCell));
+    frame.back = realloc(frame.back, cells * sizeof(FrameCell));
+    for (size_t i = 0; i < cells; i++) {
+        frame.front[i] = FRAME_BLANK;
+        frame.back[i] = FRAME_BLANK;
+    }
+    frame.full_redraw = true;
+}
+
+// Start ncurses and the framebuffer. Use instead of initscr().
+static void frame_init(void) {
+    initscr();
+    refresh(); // Let ncurses clear the screen once; it draws nothing after this
+    frame_resize();
+}
+
+// Start a new frame with every cell blank. Replaces clear().
+static void frame_begin(void) {
+    if (COLS != frame.width || LINES != frame.height) {
+        frame_resize();
+    }
+    size_t cells = (size_t)frame.width * frame.height;
+    for (size_t i = 0; i < cells; i++) {
+        frame.back[i] = FRAME_BLANK;
+    }
+}
+
+// Bytes in the UTF-8 sequence starting at text, or 0 if it is malformed
+static int frame_sequence_length(const char *text) {
+    unsigned char lead = (unsigned char)text[0];
+    int length = lead < 0x80 ? 1 : lead >= 0xC2 && lead < 0xE0 ? 2 :
+                 lead >= 0xE0 && lead < 0xF0 ? 3 : lead >= 0xF0 && lead < 0xF5 ? 4 : 0;
+    for (int i = 1; i < length; i++) {
+        if (((unsigned char)text[i] & 0xC0) != 0x80) {
+            return 0;
+        }
+    }
+    return length;
+}
+
+// Draw formatted text at (y, x) in color pair (0 for the default colors),
+// clipped to the screen. Replaces attron + mvprintw + attroff.
+static void frame_print(int y, int x, int pair, const char *format, ...) {
+    char text[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+
+    if (y < 0 || y >= frame.height) {
+        return;
+    }
+    // Each character takes one cell, multibyte ones included
+    for (const char *c = text; *c; x++) {
+        int length = frame_sequence_length(c);
+        if (x >= 0 && x < frame.width) {
+            FrameCell *cell = &frame.back[y * frame.width + x];
+            memset(cell->ch, 0, sizeof(cell->ch));
+            if (length > 0) {
+                memcpy(cell->ch, c, length);
+            } else {
+                cell->ch[0] = '?';
+            }
+            cell->pair = (unsigned char)pair;
+        }
+        c += length > 0 ? length : 1;
+    }
+}
+
+// Write the cells that changed since the previous frame in one batch
+static void frame_present(void) {
+    frame.output_length = 0;
+    if (frame.full_redraw) {
+        frame.pair = -1;
+        frame_set_pair(0);
+        frame_append_cap(tigetstr("clear"));
+        frame.cursor_y = frame.cursor_x = 0;
+    }
+
+    const char *cursor_address = tigetstr("cup");
+    for (int y = 0; y < frame.height; y++) {
+        for (int x = 0; x < frame.width; x++) {
+            int i = y * frame.width + x;
+            FrameCell cell = frame.back[i];
+            if (!frame.full_redraw && memcmp(&cell, &frame.front[i], sizeof(cell)) == 0) {
+                continue;
+            }
+            if (frame.full_redraw && memcmp(&cell, &FRAME_BLANK, sizeof(cell)) == 0) {
+                continue; // Already blank after the clear
+            }
+            if (y != frame.cursor_y || x != frame.cursor_x) {
+                frame_append_cap(tiparm(cursor_address, y, x));
+            }
+            frame_set_pair(cell.pair);
+            // The whole sequence goes out together, so it is never split
+            frame_append(cell.ch, strnlen(cell.ch, sizeof(cell.ch)));
+            frame.cursor_y = y;
+            // A multibyte character's width on screen is unknown, so force a
+            // move before the next cell
+            frame.cursor_x = (unsigned char)cell.ch[0] < 0x80 ? x + 1 : -1;
+            frame.front[i] = cell;
+            frame.cells_sent++;
+        }
+    }
+    frame.full_redraw = false;
+
+    size_t done = 0;
+    while (done < frame.output_length) {
+        ssize_t written = write(STDOUT_FILENO, frame.output + done, frame.output_length - done);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        done += written;
+        frame.writes++;
+    }
+
+    frame.frames++;
+    frame.bytes_last = frame.output_length;
+    frame.bytes_total += frame.output_length;
+    if (frame.bytes_last > frame.bytes_max) frame.bytes_max = frame.bytes_last;
+}
+
+// Leave ncurses and print the output statistics. Replaces endwin().
+static void frame_end(void) {
+    frame.output_length = 0;
+    frame_set_pair(0);
+    if (frame.output_length > 0 && write(STDOUT_FILENO, frame.output, frame.output_length) < 0) {
+        // Nothing useful to do if the terminal is gone
+    }
+    endwin();
+    if (frame.frames > 0) {
+        fprintf(stderr, "Frames: %ld  bytes/frame: avg %.1f  max %zu  last %zu  "
+                "writes/frame: %.2f  cells sent/frame: %.1f\n",
+                frame.frames, (double)frame.bytes_total / frame.frames, frame.bytes_max,
+                frame.bytes_last, (double)frame.writes / frame.frames,
+                (double)frame.cells_sent / frame.frames);
+    }
+    free(frame.front);
+    free(frame.back);
+    free(frame.output);
+    memset(&frame, 0, sizeof(frame));
+}
+
+#endif
@@ -4,13 +4,23 @@
 #include <unistd.h>
 #include <ncurses.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#include "term_frame.h"
+#include "game_runtime.h"
+#include "thread_pool.h"
 
 // Add function prototype at the beginning
-long millis();
+double seconds_now();
 
 #define WIDTH 10
 #define HEIGHT 20
 #define BLOCK_SIZE 4
+#define TICK_MS 10 // Game logic advances in fixed ticks so games can be replayed
+#define KEY_QUEUE 16 // Keys waiting for their tick
 
 // Tetrimino shapes
 const int shapes[7][4][4][4] = {
@@ -76,11 +86,44 @@ const int colors[7] = {
     COLOR_RED      // Z
 };
 
-int board[HEIGHT][WIDTH] = {0};
-int score = 0;
-int level = 1;
-int lines_cleared = 0;
-int fall_speed = 1000; // ms
+
+// Bitboard layout: bit (BOARD_PAD + x) of a row is column x. Bits outside the
+// playfield are permanently set so they act as walls, and BLOCK_SIZE solid
+// rows below the last line act as the floor.
+#define BOARD_PAD 4
+#define FULL_ROW 0xFFFFFFFFu
+#define PLAYFIELD_MASK (((1u << WIDTH) - 1) << BOARD_PAD)
+#define EMPTY_ROW (FULL_ROW & ~PLAYFIELD_MASK)
+
+// Benchmark defaults
+#define BENCH_GAMES 1000
+#define BENCH_MAX_PIECES 10000 // Cap per game so a good policy still terminates
+
+// Autoplayer settings
+#define PREVIEW_COUNT 2       // Upcoming pieces shown and searched by the AI
+#define AI_BUDGET_US 1000     // Default thinking time per piece
+#define AI_BEAM_WIDTH 8       // Children expanded per node below the root
+#define AI_ROOT_BEAM 16       // Children expanded at the root
+#define AI_TT_BITS 16         // log2 of transposition table entries
+#define AI_X_RANGE (WIDTH + BOARD_PAD)
+#define AI_STATES (4 * AI_X_RANGE * HEIGHT)
+#define AI_MAX_PLACEMENTS 256
+#define AI_LOSS -1e9f
+
+// Battle mode
+#define BATTLE_BOARDS 0     // 0 runs a sweep over board and thread counts
+#define BATTLE_TICKS 1000
+#define BATTLE_CHUNK 16     // Boards stepped together by one worker
+
+// Giant-board stress mode
+#define GIANT_PIECES 1000000
+#define GIANT_MAX_WIDTH 65536
+#define GIANT_WINDOW 16 // Columns the stress policy considers per piece
+
+// Row masks for every piece and rotation (bit x = column x of the shape)
+uint32_t piece_masks[7][4][BLOCK_SIZE];
+// Lowest occupied row of each shape column, -1 if the column is empty
+int piece_bottoms[7][4][BLOCK_SIZE];
 
 typedef struct {
     int x;
@@ -89,29 +132,135 @@ typedef struct {
     int rotation;
 } Tetrimino;
 
-Tetrimino current;
+// Occupancy plus metrics kept up to date by merge_piece and remove_full_rows
+typedef struct {
+    uint32_t rows[HEIGHT + BLOCK_SIZE];
+    unsigned char heights[WIDTH];   // Column heights from the floor
+    unsigned char holes[WIDTH];     // Empty cells below each column's top
+    unsigned char row_fill[HEIGHT]; // Filled cells per row
+    int total_holes;
+} Board;
+
+// Complete state of one game, so any number of games can run side by side
+typedef struct {
+    Board board;
+    unsigned char colors[HEIGHT][WIDTH]; // Color plane, 0 = empty
+    Tetrimino current;
+    int next_types[PREVIEW_COUNT];
+    int score;
+    int level;
+    int lines_cleared;
+    int fall_speed; // ms
+    long pieces_placed;
+    long ticks;
+    long last_fall_tick;
+    unsigned int rng_state;
+    bool game_over;
+} TetrisGame;
+
+void init_piece_masks() {
+    for (int type = 0; type < 7; type++) {
+        for (int rotation = 0; rotation < 4; rotation++) {
+            for (int x = 0; x < BLOCK_SIZE; x++) {
+                piece_bottoms[type][rotation][x] = -1;
+            }
+            for (int y = 0; y < BLOCK_SIZE; y++) {
+                uint32_t mask = 0;
+                for (int x = 0; x < BLOCK_SIZE; x++) {
+                    if (shapes[type][rotation][y][x]) {
+                        mask |= 1u << x;
+                        piece_bottoms[type][rotation][x] = y;
+                    }
+                }
+                piece_masks[type][rotation][y] = mask;
+            }
+        }
+    }
+}
+
+// Per-game random numbers (counter hashed with the murmur3 finalizer)
+unsigned int next_random(unsigned int *state) {
+    unsigned int z = (*state += 0x9E3779B9u);
+    z = (z ^ (z >> 16)) * 0x85EBCA6Bu;
+    z = (z ^ (z >> 13)) * 0xC2B2AE35u;
+    return z ^ (z >> 16);
+}
 
-void init_game() {
-    // Initialize board
+void init_board(Board *board) {
+    // Empty rows with walls, then the solid floor
     for (int y = 0; y < HEIGHT; y++) {
-        for (int x = 0; x < WIDTH; x++) {
-            board[y][x] = 0;
+        board->rows[y] = EMPTY_ROW;
+    }
+    for (int y = HEIGHT; y < HEIGHT + BLOCK_SIZE; y++) {
+        board->rows[y] = FULL_ROW;
+    }
+    memset(board->heights, 0, sizeof(board->heights));
+    memset(board->holes, 0, sizeof(board->holes));
+    memset(board->row_fill, 0, sizeof(board->row_fill));
+    board->total_holes = 0;
+}
+
+Tetrimino new_tetrimino(TetrisGame *game) {
+    Tetrimino t;
+    t.type = game->next_types[0];
+    for (int i = 1; i < PREVIEW_COUNT; i++) {
+        game->next_types[i - 1] = game->next_types[i];
+    }
+    game->next_types[PREVIEW_COUNT - 1] = next_random(&game->rng_state) % 7;
+    t.rotation = 0;
+    t.x = WIDTH / 2 - BLOCK_SIZE / 2;
+    t.y = 0;
+    return t;
+}
+
+bool check_collision(const Board *board, Tetrimino t) {
+    int shift = t.x + BOARD_PAD;
+    if (shift < 0 || shift > 32 - BLOCK_SIZE) {
+        return true;
+    }
+
+    const uint32_t *mask = piece_masks[t.type][t.rotation];
+    for (int y = 0; y < BLOCK_SIZE; y++) {
+        if (mask[y]) {
+            int board_y = t.y + y;
+            // Rows above the top only have walls
+            uint32_t row = board_y < 0 ? EMPTY_ROW : board->rows[board_y];
+            if (row & (mask[y] << shift)) {
+                return true;
+            }
         }
     }
-    
-    score = 0;
-    level = 1;
-    lines_cleared = 0;
-    fall_speed = 1000;
-    
+    return false;
+}
+
+void init_game(TetrisGame *game, unsigned int seed) {
+    init_board(&game->board);
+    memset(game->colors, 0, sizeof(game->colors));
+
+    game->score = 0;
+    game->level = 1;
+    game->lines_cleared = 0;
+    game->fall_speed = 1000;
+    game->pieces_placed = 0;
+    game->ticks = 0;
+    game->last_fall_tick = 0;
+    game->rng_state = seed;
+    for (int i = 0; i < PREVIEW_COUNT; i++) {
+        game->next_types[i] = next_random(&game->rng_state) % 7;
+    }
+    game->current = new_tetrimino(game);
+    game->game_over = check_collision(&game->board, game->current);
+}
+
+void init_screen() {
     // Initialize ncurses
-    initscr();
+    frame_init();
     cbreak();
     noecho();
     curs_set(0);
     keypad(stdscr, TRUE);
     nodelay(stdscr, TRUE);
-    
+
     // Initialize colors
     if (has_colors()) {
         start_color();
@@ -125,258 +274,1760 @@ void init_game() {
     }
 }
 
-void draw_board() {
-    clear();
-    
+void merge_piece(Board *board, Tetrimino t) {
+    const uint32_t *mask = piece_masks[t.type][t.rotation];
+    // Bottom row first, so each column's cells arrive in height order
+    for (int y = BLOCK_SIZE - 1; y >= 0; y--) {
+        int board_y = t.y + y;
+        if (board_y < 0 || !mask[y]) {
+            continue;
+        }
+        board->rows[board_y] |= mask[y] << (t.x + BOARD_PAD);
+        for (uint32_t bits = mask[y]; bits; bits &= bits - 1) {
+            int x = t.x + __builtin_ctz(bits);
+            int height = HEIGHT - board_y;
+            if (height > board->heights[x]) {
+                // Cells skipped over between the old top and this one
+                int skipped = height - 1 - board->heights[x];
+                board->holes[x] += skipped;
+                board->total_holes += skipped;
+                board->heights[x] = height;
+            } else {
+                // Slid in under an overhang
+                board->holes[x]--;
+                board->total_holes--;
+            }
+            board->row_fill[board_y]++;
+        }
+    }
+}
+
+void merge_tetrimino(TetrisGame *game) {
+    const Tetrimino *current = &game->current;
+    const uint32_t *mask = piece_masks[current->type][current->rotation];
+    merge_piece(&game->board, *current);
+    for (int y = 0; y < BLOCK_SIZE; y++) {
+        int board_y = current->y + y;
+        if (board_y < 0) {
+            continue;
+        }
+        for (uint32_t bits = mask[y]; bits; bits &= bits - 1) {
+            game->colors[board_y][current->x + __builtin_ctz(bits)] = colors[current->type];
+        }
+    }
+}
+
+// Remove full rows from the board. Returns the number of lines removed.
+int remove_full_rows(Board *board) {
+    int removed = 0;
+    int dest = HEIGHT - 1;
+    for (int y = HEIGHT - 1; y >= 0; y--) {
+        if (board->rows[y] == FULL_ROW) {
+            removed++;
+            continue;
+        }
+        board->row_fill[dest] = board->row_fill[y];
+        board->rows[dest--] = board->rows[y];
+    }
+    for (; dest >= 0; dest--) {
+        board->rows[dest] = EMPTY_ROW;
+        board->row_fill[dest] = 0;
+    }
+
+    // A full row lies below or at every column's top and holds no holes,
+    // so each cleared line lowers every column by one. Where a cleared row
+    // was a column's top, the empty cells under it were holes and the top
+    // drops to the next filled cell.
+    if (removed > 0) {
+        for (int x = 0; x < WIDTH; x++) {
+            uint32_t bit = 1u << (x + BOARD_PAD);
+            board->heights[x] -= removed;
+            while (board->heights[x] > 0 && !(board->rows[HEIGHT - board->heights[x]] & bit)) {
+                board->heights[x]--;
+                board->holes[x]--;
+                board->total_holes--;
+            }
+        }
+    }
+    return removed;
+}
+
+// Rows the piece can fall before landing, from the column heights when the
+// piece is above the stack in all of its columns
+int drop_distance(const Board *board, Tetrimino t) {
+    int distance = HEIGHT;
+    for (int x = 0; x < BLOCK_SIZE; x++) {
+        int bottom = piece_bottoms[t.type][t.rotation][x];
+        if (bottom < 0) {
+            continue;
+        }
+        int free_rows = HEIGHT - board->heights[t.x + x] - 1 - (t.y + bottom);
+        if (free_rows < 0) {
+            // Under an overhang: walk down the slow way
+            int rows = 0;
+            do {
+                t.y++;
+                rows++;
+            } while (!check_collision(board, t));
+            return rows - 1;
+        }
+        if (free_rows < distance) distance = free_rows;
+    }
+    return distance;
+}
+
+void draw_board(const TetrisGame *game) {
+    frame_begin();
+
     // Draw border
     for (int y = 0; y < HEIGHT; y++) {
-        mvprintw(y, 0, "|");
-        mvprintw(y, WIDTH * 2 + 1, "|");
+        frame_print(y, 0, 0, "|");
+        frame_print(y, WIDTH * 2 + 1, 0, "|");
     }
     for (int x = 0; x < WIDTH * 2 + 2; x++) {
-        mvprintw(HEIGHT, x, "-");
+        frame_print(HEIGHT, x, 0, "-");
     }
-    
+
     // Draw board
     for (int y = 0; y < HEIGHT; y++) {
         for (int x = 0; x < WIDTH; x++) {
-            if (board[y][x]) {
-                attron(COLOR_PAIR(board[y][x]));
-                mvprintw(y, x * 2 + 1, "[]");
-                attroff(COLOR_PAIR(board[y][x]));
+            if (game->colors[y][x]) {
+                frame_print(y, x * 2 + 1, game->colors[y][x], "[]");
             }
         }
     }
-    
-    // Draw current tetrimino
+
+    // Draw the ghost piece where the current one would land
+    const Tetrimino *current = &game->current;
+    int ghost_y = current->y + drop_distance(&game->board, *current);
     for (int y = 0; y < BLOCK_SIZE; y++) {
         for (int x = 0; x < BLOCK_SIZE; x++) {
-            if (shapes[current.type][current.rotation][y][x]) {
-                attron(COLOR_PAIR(colors[current.type]));
-                mvprintw(current.y + y, (current.x + x) * 2 + 1, "[]");
-                attroff(COLOR_PAIR(colors[current.type]));
+            if (shapes[current->type][current->rotation][y][x]) {
+                frame_print(ghost_y + y, (current->x + x) * 2 + 1, 0, "::");
             }
         }
     }
-    
-    // Draw score and level
-    mvprintw(1, WIDTH * 2 + 5, "Score: %d", score);
-    mvprintw(3, WIDTH * 2 + 5, "Level: %d", level);
-    mvprintw(5, WIDTH * 2 + 5, "Lines: %d", lines_cleared);
-    
-    // Draw controls
-    mvprintw(8, WIDTH * 2 + 5, "Controls:");
-    mvprintw(9, WIDTH * 2 + 5, "Left:  ←");
-    mvprintw(10, WIDTH * 2 + 5, "Right: →");
-    mvprintw(11, WIDTH * 2 + 5, "Rotate: ↑");
-    mvprintw(12, WIDTH * 2 + 5, "Drop: ↓");
-    mvprintw(13, WIDTH * 2 + 5, "Quit: q");
-    
-    refresh();
-}
-
-Tetrimino new_tetrimino() {
-    Tetrimino t;
-    t.type = rand() % 7;
-    t.rotation = 0;
-    t.x = WIDTH / 2 - BLOCK_SIZE / 2;
-    t.y = 0;
-    return t;
-}
 
-bool check_collision(Tetrimino t) {
+    // Draw current tetrimino
     for (int y = 0; y < BLOCK_SIZE; y++) {
         for (int x = 0; x < BLOCK_SIZE; x++) {
-            if (shapes[t.type][t.rotation][y][x]) {
-                int board_x = t.x + x;
-                int board_y = t.y + y;
-                
-                if (board_x < 0 || board_x >= WIDTH || board_y >= HEIGHT) {
-                    return true;
-                }
-                
-                if (board_y >= 0 && board[board_y][board_x]) {
-                    return true;
-                }
+            if (shapes[current->type][current->rotation][y][x]) {
+                frame_print(current->y + y, (current->x + x) * 2 + 1, colors[current->type], "[]");
             }
         }
     }
-    return false;
-}
 
-void merge_tetrimino() {
+    // Draw score and level
+    frame_print(1, WIDTH * 2 + 5, 0, "Score: %d", game->score);
+    frame_print(3, WIDTH * 2 + 5, 0, "Level: %d", game->level);
+    frame_print(5, WIDTH * 2 + 5, 0, "Lines: %d", game->lines_cleared);
+
+    // Draw controls
+    frame_print(8, WIDTH * 2 + 5, 0, "Controls:");
+    frame_print(9, WIDTH * 2 + 5, 0, "Left:  ←");
+    frame_print(10, WIDTH * 2 + 5, 0, "Right: →");
+    frame_print(11, WIDTH * 2 + 5, 0, "Rotate: ↑");
+    frame_print(12, WIDTH * 2 + 5, 0, "Drop: ↓");
+    frame_print(13, WIDTH * 2 + 5, 0, "Hard drop: space");
+    frame_print(14, WIDTH * 2 + 5, 0, "Quit: q");
+
+    // Draw the next piece
+    frame_print(15, WIDTH * 2 + 5, 0, "Next:");
+    int next = game->next_types[0];
     for (int y = 0; y < BLOCK_SIZE; y++) {
         for (int x = 0; x < BLOCK_SIZE; x++) {
-            if (shapes[current.type][current.rotation][y][x]) {
-                int board_x = current.x + x;
-                int board_y = current.y + y;
-                if (board_y >= 0) {
-                    board[board_y][board_x] = colors[current.type];
-                }
+            if (shapes[next][0][y][x]) {
+                frame_print(16 + y, WIDTH * 2 + 5 + x * 2, colors[next], "[]");
             }
         }
     }
+
+    frame_present();
 }
 
-void clear_lines() {
-    int lines_to_clear = 0;
-    
+void clear_lines(TetrisGame *game) {
+    // Compact the color plane the same way the board is about to be
+    int dest = HEIGHT - 1;
     for (int y = HEIGHT - 1; y >= 0; y--) {
-        bool line_complete = true;
-        for (int x = 0; x < WIDTH; x++) {
-            if (!board[y][x]) {
-                line_complete = false;
-                break;
-            }
+        if (game->board.rows[y] == FULL_ROW) {
+            continue;
         }
-        
-        if (line_complete) {
-            lines_to_clear++;
-            // Move all lines above down
-            for (int y2 = y; y2 > 0; y2--) {
-                for (int x = 0; x < WIDTH; x++) {
-                    board[y2][x] = board[y2 - 1][x];
-                }
-            }
-            // Clear top line
-            for (int x = 0; x < WIDTH; x++) {
-                board[0][x] = 0;
-            }
-            y++; // Check the same line again
+        if (dest != y) {
+            memcpy(game->colors[dest], game->colors[y], WIDTH);
         }
+        dest--;
+    }
+    // Clear the rows freed at the top
+    for (; dest >= 0; dest--) {
+        memset(game->colors[dest], 0, WIDTH);
     }
-    
+
+    int lines_to_clear = remove_full_rows(&game->board);
+
     if (lines_to_clear > 0) {
         // Update score
         switch (lines_to_clear) {
-            case 1: score += 100 * level; break;
-            case 2: score += 300 * level; break;
-            case 3: score += 500 * level; break;
-            case 4: score += 800 * level; break;
-        }
-        
-        lines_cleared += lines_to_clear;
-        
+            case 1: game->score += 100 * game->level; break;
+            case 2: game->score += 300 * game->level; break;
+            case 3: game->score += 500 * game->level; break;
+            case 4: game->score += 800 * game->level; break;
+        }
+
+        game->lines_cleared += lines_to_clear;
+
         // Update level every 10 lines
-        level = lines_cleared / 10 + 1;
-        
+        game->level = game->lines_cleared / 10 + 1;
+
         // Increase speed
-        fall_speed = 1000 - (level - 1) * 100;
-        if (fall_speed < 100) fall_speed = 100;
+        game->fall_speed = 1000 - (game->level - 1) * 100;
+        if (game->fall_speed < 100) game->fall_speed = 100;
     }
 }
 
-void rotate_tetrimino() {
-    Tetrimino temp = current;
+// Rotate t clockwise on board, applying the wall kicks. Returns false if blocked.
+bool try_rotate(const Board *board, Tetrimino *t) {
+    Tetrimino temp = *t;
     temp.rotation = (temp.rotation + 1) % 4;
-    
+
     // Try wall kicks
-    if (!check_collision(temp)) {
-        current = temp;
-        return;
+    if (!check_collision(board, temp)) {
+        *t = temp;
+        return true;
     }
-    
+
     // Try moving left
     temp.x--;
-    if (!check_collision(temp)) {
-        current = temp;
-        return;
+    if (!check_collision(board, temp)) {
+        *t = temp;
+        return true;
     }
-    
+
     // Try moving right
     temp.x += 2;
-    if (!check_collision(temp)) {
-        current = temp;
-        return;
+    if (!check_collision(board, temp)) {
+        *t = temp;
+        return true;
     }
-    
+
     // Try moving left again (for I piece)
     temp.x -= 3;
-    if (!check_collision(temp)) {
-        current = temp;
-        return;
+    if (!check_collision(board, temp)) {
+        *t = temp;
+        return true;
     }
+    return false;
 }
 
-void game_loop() {
-    srand(time(NULL));
-    current = new_tetrimino();
-    long last_fall = 0;
-    bool game_over = false;
-    
-    while (!game_over) {
-        long now = millis();
-        
-        // Handle input
-        int ch = getch();
-        switch (ch) {
-            case KEY_LEFT:
-                current.x--;
-                if (check_collision(current)) current.x++;
-                break;
-            case KEY_RIGHT:
-                current.x++;
-                if (check_collision(current)) current.x--;
-                break;
-            case KEY_DOWN:
-                current.y++;
-                if (check_collision(current)) {
-                    current.y--;
-                    merge_tetrimino();
-                    clear_lines();
-                    current = new_tetrimino();
-                    if (check_collision(current)) {
-                        game_over = true;
-                    }
-                }
-                last_fall = now;
-                break;
-            case KEY_UP:
-                rotate_tetrimino();
-                break;
-            case 'q':
-                game_over = true;
-                break;
+void rotate_tetrimino(TetrisGame *game) {
+    try_rotate(&game->board, &game->current);
+}
+
+bool move_tetrimino(TetrisGame *game, int dx) {
+    game->current.x += dx;
+    if (check_collision(&game->board, game->current)) {
+        game->current.x -= dx;
+        return false;
+    }
+    return true;
+}
+
+// Merge the current piece, clear lines and spawn the next one
+void lock_tetrimino(TetrisGame *game) {
+    merge_tetrimino(game);
+    clear_lines(game);
+    game->pieces_placed++;
+    game->current = new_tetrimino(game);
+    if (check_collision(&game->board, game->current)) {
+        game->game_over = true;
+    }
+}
+
+// Move the piece down one row, locking it if it cannot move. Returns true on lock.
+bool step_game(TetrisGame *game) {
+    game->current.y++;
+    if (check_collision(&game->board, game->current)) {
+        game->current.y--;
+        lock_tetrimino(game);
+        return true;
+    }
+    return false;
+}
+
+// Recompute the board metrics from scratch after a bulk edit
+void recompute_metrics(Board *board) {
+    board->total_holes = 0;
+    for (int x = 0; x < WIDTH; x++) {
+        uint32_t bit = 1u << (x + BOARD_PAD);
+        board->heights[x] = 0;
+        board->holes[x] = 0;
+        for (int y = 0; y < HEIGHT; y++) {
+            if (board->rows[y] & bit) {
+                if (!board->heights[x]) board->heights[x] = HEIGHT - y;
+            } else if (board->heights[x]) {
+                board->holes[x]++;
+            }
+        }
+        board->total_holes += board->holes[x];
+    }
+    for (int y = 0; y < HEIGHT; y++) {
+        board->row_fill[y] = __builtin_popcount(board->rows[y] & PLAYFIELD_MASK);
+    }
+}
+
+// Push the stack up and fill the bottom with garbage rows that have one
+// empty cell at column hole. Ends the game if blocks are pushed off the top.
+void add_garbage(TetrisGame *game, int lines, int hole) {
+    if (lines > HEIGHT) lines = HEIGHT;
+    for (int y = 0; y < lines; y++) {
+        if (game->board.rows[y] != EMPTY_ROW) {
+            game->game_over = true;
+        }
+    }
+    memmove(game->board.rows, game->board.rows + lines, (HEIGHT - lines) * sizeof(uint32_t));
+    memmove(game->colors, game->colors + lines, (HEIGHT - lines) * WIDTH);
+    for (int y = HEIGHT - lines; y < HEIGHT; y++) {
+        game->board.rows[y] = FULL_ROW & ~(1u << (hole + BOARD_PAD));
+        memset(game->colors[y], COLOR_WHITE, WIDTH);
+        game->colors[y][hole] = 0;
+    }
+    recompute_metrics(&game->board);
+    if (check_collision(&game->board, game->current)) {
+        game->game_over = true;
+    }
+}
+
+// Drop the piece as far as it goes and lock it. Returns the rows dropped.
+int drop_tetrimino(TetrisGame *game) {
+    int rows = drop_distance(&game->board, game->current);
+    game->current.y += rows;
+    lock_tetrimino(game);
+    return rows;
+}
+
+void apply_key(TetrisGame *game, int key) {
+    switch (key) {
+        case KEY_LEFT:
+            move_tetrimino(game, -1);
+            break;
+        case KEY_RIGHT:
+            move_tetrimino(game, 1);
+            break;
+        case KEY_DOWN:
+            step_game(game);
+            game->last_fall_tick = game->ticks;
+            break;
+        case KEY_UP:
+            rotate_tetrimino(game);
+            break;
+        case ' ':
+            drop_tetrimino(game);
+            game->last_fall_tick = game->ticks;
+            break;
+        case 'q':
+            game->game_over = true;
+            break;
+    }
+}
+
+// Heuristic weights for a settled board (aggregate height, holes, bumpiness)
+// and for each line cleared on the way there
+const float WEIGHT_HEIGHT = -0.510066f;
+const float WEIGHT_LINES = 0.760666f;
+const float WEIGHT_HOLES = -0.35663f;
+const float WEIGHT_BUMPINESS = -0.184483f;
+
+typedef struct {
+    uint64_t key;
+    float value;
+} TTEntry;
+
+typedef struct {
+    Tetrimino piece;
+    int lines;
+    float value;
+    Board board; // Board after the piece is merged and lines are removed
+} Placement;
+
+// Autoplayer state: search scratch space, transposition table and the
+// input path currently being executed
+typedef struct {
+    long budget_us;
+    double deadline;
+    bool aborted;
+    long nodes;
+    TTEntry *table;
+    short parent[AI_STATES];
+    short root_parent[AI_STATES];
+    int queue[AI_STATES];
+    Tetrimino plan[AI_STATES];
+    int plan_length;
+    int plan_pos;
+    // Statistics
+    long decisions;
+    long depth_total;
+    long tt_hits;
+    double think_total;
+    double think_max;
+} TetrisAI;
+
+void init_ai(TetrisAI *ai, long budget_us) {
+    memset(ai, 0, sizeof(*ai));
+    ai->budget_us = budget_us;
+    ai->table = calloc(1u << AI_TT_BITS, sizeof(TTEntry));
+}
+
+void free_ai(TetrisAI *ai) {
+    free(ai->table);
+    ai->table = NULL;
+}
+
+int state_index(Tetrimino t) {
+    return (t.rotation * AI_X_RANGE + t.x + BOARD_PAD) * HEIGHT + t.y;
+}
+
+// Breadth-first search over every position the piece can reach from start
+// with left/right/down/rotate inputs. Resting positions are written to out.
+// ai->parent is left holding the search tree so paths can be rebuilt.
+int enumerate_placements(TetrisAI *ai, const Board *board, Tetrimino start, Tetrimino *out) {
+    int head = 0;
+    int tail = 0;
+    int count = 0;
+
+    memset(ai->parent, 0xFF, sizeof(ai->parent));
+    ai->parent[state_index(start)] = (short)state_index(start);
+    ai->queue[tail++] = state_index(start);
+
+    while (head < tail) {
+        int index = ai->queue[head++];
+        Tetrimino t = start;
+        t.y = index % HEIGHT;
+        t.x = (index / HEIGHT) % AI_X_RANGE - BOARD_PAD;
+        t.rotation = index / (HEIGHT * AI_X_RANGE);
+
+        Tetrimino next[4] = { t, t, t, t };
+        bool valid[4];
+        next[0].x--;
+        valid[0] = !check_collision(board, next[0]);
+        next[1].x++;
+        valid[1] = !check_collision(board, next[1]);
+        next[2].y++;
+        valid[2] = !check_collision(board, next[2]);
+        valid[3] = try_rotate(board, &next[3]);
+
+        if (!valid[2] && count < AI_MAX_PLACEMENTS) {
+            out[count++] = t;
         }
-        
-        // Automatic falling
-        if (now - last_fall > fall_speed) {
-            current.y++;
-            if (check_collision(current)) {
-                current.y--;
-                merge_tetrimino();
-                clear_lines();
-                current = new_tetrimino();
-                if (check_collision(current)) {
-                    game_over = true;
+        for (int i = 0; i < 4; i++) {
+            if (valid[i]) {
+                int next_index = state_index(next[i]);
+                if (ai->parent[next_index] < 0) {
+                    ai->parent[next_index] = (short)index;
+                    ai->queue[tail++] = next_index;
                 }
             }
-            last_fall = now;
         }
-        
-        draw_board();
-        usleep(10000); // Small delay to prevent CPU overuse
     }
-    
+    return count;
+}
+
+float evaluate_board(const Board *board) {
+    int aggregate = 0;
+    int bumpiness = 0;
+    for (int x = 0; x < WIDTH; x++) {
+        aggregate += board->heights[x];
+        if (x > 0) {
+            bumpiness += abs(board->heights[x] - board->heights[x - 1]);
+        }
+    }
+    return WEIGHT_HEIGHT * aggregate + WEIGHT_HOLES * board->total_holes +
+           WEIGHT_BUMPINESS * bumpiness;
+}
+
+uint64_t hash_position(const Board *board, const int *pieces, int count) {
+    uint64_t hash = 0xCBF29CE484222325ull ^ (uint64_t)count;
+    for (int y = 0; y < HEIGHT; y++) {
+        hash = (hash ^ board->rows[y]) * 0x9E3779B97F4A7C15ull;
+        hash ^= hash >> 29;
+    }
+    for (int i = 0; i < count; i++) {
+        hash = (hash ^ (uint64_t)(pieces[i] + 1)) * 0x9E3779B97F4A7C15ull;
+        hash ^= hash >> 29;
+    }
+    return hash | 1; // 0 marks an empty slot
+}
+
+int compare_placements(const void *a, const void *b) {
+    float value_a = ((const Placement *)a)->value;
+    float value_b = ((const Placement *)b)->value;
+    return (value_a < value_b) - (value_a > value_b);
+}
+
+Tetrimino spawn_piece(int type) {
+    Tetrimino t = { WIDTH / 2 - BLOCK_SIZE / 2, 0, type, 0 };
+    return t;
+}
+
+// Enumerate, merge and statically score every placement of start on board,
+// best first. Returns the number of placements.
+int expand_placements(TetrisAI *ai, const Board *board, Tetrimino start, Placement *out) {
+    Tetrimino resting[AI_MAX_PLACEMENTS];
+    int count = enumerate_placements(ai, board, start, resting);
+    for (int i = 0; i < count; i++) {
+        out[i].piece = resting[i];
+        out[i].board = *board;
+        merge_piece(&out[i].board, resting[i]);
+        out[i].lines = remove_full_rows(&out[i].board);
+        out[i].value = WEIGHT_LINES * out[i].lines + evaluate_board(&out[i].board);
+    }
+    qsort(out, count, sizeof(Placement), compare_placements);
+    return count;
+}
+
+bool out_of_time(TetrisAI *ai) {
+    ai->nodes++;
+    if (!ai->aborted && seconds_now() > ai->deadline) {
+        ai->aborted = true;
+    }
+    return ai->aborted;
+}
+
+// Best value reachable from board by placing pieces[0..count-1] in order
+float search(TetrisAI *ai, const Board *board, const int *pieces, int count) {
+    if (count == 0) {
+        return evaluate_board(board);
+    }
+
+    Tetrimino start = spawn_piece(pieces[0]);
+    if (check_collision(board, start)) {
+        return AI_LOSS;
+    }
+
+    uint64_t key = hash_position(board, pieces, count);
+    TTEntry *entry = &ai->table[key & ((1u << AI_TT_BITS) - 1)];
+    if (entry->key == key) {
+        ai->tt_hits++;
+        return entry->value;
+    }
+    if (out_of_time(ai)) {
+        return AI_LOSS;
+    }
+
+    Placement children[AI_MAX_PLACEMENTS];
+    int child_count = expand_placements(ai, board, start, children);
+    float best = AI_LOSS;
+    if (count == 1) {
+        best = child_count > 0 ? children[0].value : AI_LOSS;
+    } else {
+        for (int i = 0; i < child_count && i < AI_BEAM_WIDTH; i++) {
+            float value = WEIGHT_LINES * children[i].lines +
+                          search(ai, &children[i].board, pieces + 1, count - 1);
+            if (value > best) best = value;
+        }
+    }
+
+    if (!ai->aborted) {
+        entry->key = key;
+        entry->value = best;
+    }
+    return best;
+}
+
+// Pick the resting position for the current piece and store the input path
+// to it in ai->plan. Searches the current piece plus the preview with
+// iterative deepening until the time budget runs out.
+void plan_placement(TetrisAI *ai, const TetrisGame *game) {
+    double start_time = seconds_now();
+    ai->deadline = start_time + ai->budget_us / 1e6;
+    ai->aborted = false;
+
+    int pieces[1 + PREVIEW_COUNT];
+    pieces[0] = game->current.type;
+    memcpy(pieces + 1, game->next_types, sizeof(game->next_types));
+
+    Placement roots[AI_MAX_PLACEMENTS];
+    int root_count = expand_placements(ai, &game->board, game->current, roots);
+    memcpy(ai->root_parent, ai->parent, sizeof(ai->parent));
+    ai->plan_length = 0;
+    ai->plan_pos = 0;
+    if (root_count == 0) {
+        return;
+    }
+
+    // Depth 1 is the static ordering itself
+    Tetrimino best = roots[0].piece;
+    int depth = 1;
+    for (int d = 2; d <= 1 + PREVIEW_COUNT; d++) {
+        float best_value = AI_LOSS;
+        Tetrimino best_piece = roots[0].piece;
+        for (int i = 0; i < root_count && i < AI_ROOT_BEAM; i++) {
+            float value = WEIGHT_LINES * roots[i].lines +
+                          search(ai, &roots[i].board, pieces + 1, d - 1);
+            if (value > best_value) {
+                best_value = value;
+                best_piece = roots[i].piece;
+            }
+        }
+        if (ai->aborted) {
+            break;
+        }
+        best = best_piece;
+        depth = d;
+    }
+
+    // Rebuild the input path from the search tree of the root position
+    int length = 0;
+    int start_index = state_index(game->current);
+    for (int index = state_index(best); ; index = ai->root_parent[index]) {
+        Tetrimino t = game->current;
+        t.y = index % HEIGHT;
+        t.x = (index / HEIGHT) % AI_X_RANGE - BOARD_PAD;
+        t.rotation = index / (HEIGHT * AI_X_RANGE);
+        ai->plan[length++] = t;
+        if (index == start_index) {
+            break;
+        }
+    }
+    for (int i = 0; i < length / 2; i++) {
+        Tetrimino temp = ai->plan[i];
+        ai->plan[i] = ai->plan[length - 1 - i];
+        ai->plan[length - 1 - i] = temp;
+    }
+    ai->plan_length = length;
+
+    double elapsed = seconds_now() - start_time;
+    ai->decisions++;
+    ai->depth_total += depth;
+    ai->think_total += elapsed;
+    if (elapsed > ai->think_max) ai->think_max = elapsed;
+}
+
+bool same_position(Tetrimino a, Tetrimino b) {
+    return a.x == b.x && a.y == b.y && a.type == b.type && a.rotation == b.rotation;
+}
+
+// Pick the next input towards the planned placement, replanning if the
+// piece has moved off the path (e.g. by gravity). Pressing down at the end
+// of the path locks the piece.
+int ai_next_key(TetrisAI *ai, const TetrisGame *game) {
+    if (ai->plan_pos >= ai->plan_length ||
+        !same_position(game->current, ai->plan[ai->plan_pos])) {
+        plan_placement(ai, game);
+        if (ai->plan_length == 0) {
+            return KEY_DOWN;
+        }
+    }
+
+    if (ai->plan_pos == ai->plan_length - 1) {
+        ai->plan_length = 0;
+        return KEY_DOWN;
+    }
+
+    Tetrimino next = ai->plan[++ai->plan_pos];
+    if (next.rotation != game->current.rotation) {
+        return KEY_UP;
+    } else if (next.x != game->current.x) {
+        return next.x < game->current.x ? KEY_LEFT : KEY_RIGHT;
+    }
+    return KEY_DOWN;
+}
+
+// One-ply placement for battle bots: every rotation and column dropped
+// straight down from the current row, scored on the maintained metrics
+void play_greedy_piece(TetrisGame *game) {
+    Tetrimino best = game->current;
+    float best_value = AI_LOSS;
+    for (int rotation = 0; rotation < 4; rotation++) {
+        for (int x = -BOARD_PAD; x < WIDTH; x++) {
+            Tetrimino t = { x, game->current.y, game->current.type, rotation };
+            if (check_collision(&game->board, t)) {
+                continue;
+            }
+            t.y += drop_distance(&game->board, t);
+            Board board = game->board;
+            merge_piece(&board, t);
+            int lines = remove_full_rows(&board);
+            float value = WEIGHT_LINES * lines + evaluate_board(&board);
+            if (value > best_value) {
+                best_value = value;
+                best = t;
+            }
+        }
+    }
+    game->current = best;
+    drop_tetrimino(game);
+}
+
+// Headless autoplay: plan and execute a whole placement at once
+void play_ai_piece(TetrisAI *ai, TetrisGame *game) {
+    long placed = game->pieces_placed;
+    while (!game->game_over && game->pieces_placed == placed) {
+        apply_key(game, ai_next_key(ai, game));
+    }
+}
+
+// Recorded games: a header with the seed, then one (tick delta, key) pair
+// per input, then an end marker with the final tick, score and board hash
+#define RECORDING_MAGIC "TTRP"
+#define RECORDING_VERSION 1
+
+typedef struct {
+    unsigned int seed;
+    unsigned char *data;
+    size_t length;
+    size_t capacity;
+    long last_tick;
+} Recording;
+
+// Compact codes for the keys that affect the game (0 ends the stream)
+int key_to_code(int key) {
+    switch (key) {
+        case KEY_LEFT: return 1;
+        case KEY_RIGHT: return 2;
+        case KEY_DOWN: return 3;
+        case KEY_UP: return 4;
+        case 'q': return 5;
+        case ' ': return 6;
+    }
+    return 0;
+}
+
+int code_to_key(int code) {
+    const int keys[] = { ERR, KEY_LEFT, KEY_RIGHT, KEY_DOWN, KEY_UP, 'q', ' ' };
+    return code > 0 && code < 7 ? keys[code] : ERR;
+}
+
+void put_byte(Recording *recording, unsigned char byte) {
+    if (recording->length == recording->capacity) {
+        recording->capacity = recording->capacity ? recording->capacity * 2 : 256;
+        recording->data = realloc(recording->data, recording->capacity);
+    }
+    recording->data[recording->length++] = byte;
+}
+
+void put_varint(Recording *recording, uint64_t value) {
+    while (value >= 0x80) {
+        put_byte(recording, (unsigned char)(value | 0x80));
+        value >>= 7;
+    }
+    put_byte(recording, (unsigned char)value);
+}
+
+bool get_varint(const unsigned char **p, const unsigned char *end, uint64_t *value) {
+    *value = 0;
+    for (int shift = 0; *p < end && shift < 64; shift += 7) {
+        unsigned char byte = *(*p)++;
+        *value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void init_recording(Recording *recording, unsigned int seed) {
+    memset(recording, 0, sizeof(*recording));
+    recording->seed = seed;
+    for (int i = 0; i < 4; i++) {
+        put_byte(recording, RECORDING_MAGIC[i]);
+    }
+    put_byte(recording, RECORDING_VERSION);
+    put_varint(recording, seed);
+}
+
+void record_key(Recording *recording, long tick, int key) {
+    int code = key_to_code(key);
+    if (code) {
+        put_varint(recording, tick - recording->last_tick);
+        put_byte(recording, code);
+        recording->last_tick = tick;
+    }
+}
+
+uint64_t hash_game(const TetrisGame *game) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (int y = 0; y < HEIGHT; y++) {
+        hash = (hash ^ game->board.rows[y]) * 0x100000001B3ull;
+        for (int x = 0; x < WIDTH; x++) {
+            hash = (hash ^ game->colors[y][x]) * 0x100000001B3ull;
+        }
+    }
+    return hash;
+}
+
+void finish_recording(Recording *recording, const TetrisGame *game) {
+    put_varint(recording, game->ticks - recording->last_tick);
+    put_byte(recording, 0);
+    put_varint(recording, game->score);
+    put_varint(recording, game->lines_cleared);
+    put_varint(recording, game->pieces_placed);
+    put_varint(recording, hash_game(game));
+}
+
+bool save_recording(const Recording *recording, const char *path) {
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+    bool ok = fwrite(recording->data, 1, recording->length, file) == recording->length;
+    return fclose(file) == 0 && ok;
+}
+
+// Advance the game by one tick: apply the key pressed in it, then gravity
+void run_tick(TetrisGame *game, int key) {
+    game->ticks++;
+    apply_key(game, key);
+    if (!game->game_over && (game->ticks - game->last_fall_tick) * TICK_MS > game->fall_speed) {
+        step_game(game);
+        game->last_fall_tick = game->ticks;
+    }
+}
+
+void game_loop(TetrisAI *ai, Recording *recording, Runtime *runtime) {
+    TetrisGame game;
+    unsigned int seed = time(NULL);
+    init_game(&game, seed);
+    if (recording) {
+        init_recording(recording, seed);
+    }
+    int keys[KEY_QUEUE];
+    int key_count = 0;
+
+    while (!game.game_over) {
+        // Sleep until a key arrives or ticks are due
+        int ticks = runtime_wait(runtime);
+
+        // Queue every pending key; each is applied on the next tick
+        int ch;
+        while ((ch = getch()) != ERR) {
+            if (key_count < KEY_QUEUE) {
+                keys[key_count++] = ch;
+            }
+        }
+
+        for (int i = 0; i < ticks && !game.game_over; i++) {
+            int key = ERR;
+            if (key_count > 0) {
+                key = keys[0];
+                memmove(keys, keys + 1, --key_count * sizeof(int));
+            }
+            if (ai && key != 'q') {
+                key = ai_next_key(ai, &game); // The autoplayer owns the piece
+            }
+            run_tick(&game, key);
+            if (recording) {
+                record_key(recording, game.ticks, key);
+            }
+        }
+
+        if (ticks > 0) {
+            draw_board(&game);
+        }
+    }
+
+    if (recording) {
+        finish_recording(recording, &game);
+    }
+
     // Game over screen
-    clear();
-    mvprintw(HEIGHT / 2, WIDTH - 5, "GAME OVER");
-    mvprintw(HEIGHT / 2 + 1, WIDTH - 8, "Final Score: %d", score);
-    mvprintw(HEIGHT / 2 + 3, WIDTH - 10, "Press any key to exit");
-    refresh();
+    frame_begin();
+    frame_print(HEIGHT / 2, WIDTH - 5, 0, "GAME OVER");
+    frame_print(HEIGHT / 2 + 1, WIDTH - 8, 0, "Final Score: %d", game.score);
+    frame_print(HEIGHT / 2 + 3, WIDTH - 10, 0, "Press any key to exit");
+    frame_present();
     nodelay(stdscr, FALSE);
     getch();
 }
 
-long millis() {
+double seconds_now() {
     struct timespec ts;
     clock_gettime(CLOCK_MONOTONIC, &ts);
-    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Random placement policy: pick a rotation and column, then hard drop
+void play_random_piece(TetrisGame *game) {
+    int rotations = next_random(&game->rng_state) % 4;
+    int target_x = (int)(next_random(&game->rng_state) % (WIDTH + 2)) - 2;
+    for (int i = 0; i < rotations; i++) {
+        rotate_tetrimino(game);
+    }
+    while (game->current.x < target_x && move_tetrimino(game, 1));
+    while (game->current.x > target_x && move_tetrimino(game, -1));
+    drop_tetrimino(game);
 }
 
-int main() {
-    init_game();
-    game_loop();
-    endwin();
+typedef struct {
+    unsigned int seed;
+    int score;
+    int lines;
+    long pieces;
+    long ai_decisions;
+    long ai_depth_total;
+    double ai_think_total;
+    double ai_think_max;
+} GameResult;
+
+typedef struct {
+    unsigned int base_seed;
+    long ai_budget_us; // 0 plays random placements instead
+    GameResult *results;
+} BenchContext;
+
+void bench_game(void *context, int index) {
+    BenchContext *bench = context;
+    GameResult *result = &bench->results[index];
+    TetrisGame game;
+    init_game(&game, bench->base_seed + index);
+
+    if (bench->ai_budget_us > 0) {
+        TetrisAI *ai = malloc(sizeof(TetrisAI));
+        init_ai(ai, bench->ai_budget_us);
+        while (!game.game_over && game.pieces_placed < BENCH_MAX_PIECES) {
+            play_ai_piece(ai, &game);
+        }
+        result->ai_decisions = ai->decisions;
+        result->ai_depth_total = ai->depth_total;
+        result->ai_think_total = ai->think_total;
+        result->ai_think_max = ai->think_max;
+        free_ai(ai);
+        free(ai);
+    } else {
+        while (!game.game_over && game.pieces_placed < BENCH_MAX_PIECES) {
+            play_random_piece(&game);
+        }
+    }
+
+    result->seed = bench->base_seed + index;
+    result->score = game.score;
+    result->lines = game.lines_cleared;
+    result->pieces = game.pieces_placed;
+}
+
+int compare_scores(const void *a, const void *b) {
+    int score_a = ((const GameResult *)a)->score;
+    int score_b = ((const GameResult *)b)->score;
+    return (score_a > score_b) - (score_a < score_b);
+}
+
+// Play game_count seeded games across thread_count workers and report throughput
+void run_benchmark(int game_count, int thread_count, unsigned int base_seed, long ai_budget_us) {
+    BenchContext bench = { base_seed, ai_budget_us, calloc(game_count, sizeof(GameResult)) };
+    ThreadPool pool;
+    init_pool(&pool, thread_count);
+
+    double start = seconds_now();
+    run_pool(&pool, game_count, bench_game, &bench);
+    double elapsed = seconds_now() - start;
+    destroy_pool(&pool);
+
+    long total_pieces = 0;
+    long total_lines = 0;
+    double total_score = 0;
+    long decisions = 0;
+    long depth_total = 0;
+    double think_total = 0;
+    double think_max = 0;
+    for (int i = 0; i < game_count; i++) {
+        total_pieces += bench.results[i].pieces;
+        total_lines += bench.results[i].lines;
+        total_score += bench.results[i].score;
+        decisions += bench.results[i].ai_decisions;
+        depth_total += bench.results[i].ai_depth_total;
+        think_total += bench.results[i].ai_think_total;
+        if (bench.results[i].ai_think_max > think_max) think_max = bench.results[i].ai_think_max;
+    }
+    qsort(bench.results, game_count, sizeof(GameResult), compare_scores);
+
+    printf("Games: %d  Threads: %d  Seeds: %u..%u\n", game_count, pool.thread_count,
+           base_seed, base_seed + game_count - 1);
+    printf("Time: %.3f s\n", elapsed);
+    printf("Placements: %ld (%.0f/sec)\n", total_pieces, total_pieces / elapsed);
+    printf("Lines: %ld (%.0f/sec)\n", total_lines, total_lines / elapsed);
+    printf("Score: min %d  p10 %d  p50 %d  p90 %d  max %d  mean %.1f\n",
+           bench.results[0].score,
+           bench.results[game_count / 10].score,
+           bench.results[game_count / 2].score,
+           bench.results[game_count * 9 / 10].score,
+           bench.results[game_count - 1].score,
+           total_score / game_count);
+    if (decisions > 0) {
+        printf("AI: budget %ld us  think mean %.0f us  max %.0f us  mean depth %.2f\n",
+               ai_budget_us, think_total / decisions * 1e6, think_max * 1e6,
+               (double)depth_total / decisions);
+    }
+    free(bench.results);
+}
+
+// Whether the incrementally kept metrics agree with a full rescan
+bool metrics_match(const Board *board) {
+    Board fresh = *board;
+    recompute_metrics(&fresh);
+    return memcmp(fresh.heights, board->heights, sizeof(fresh.heights)) == 0 &&
+           memcmp(fresh.holes, board->holes, sizeof(fresh.holes)) == 0 &&
+           memcmp(fresh.row_fill, board->row_fill, sizeof(fresh.row_fill)) == 0 &&
+           fresh.total_holes == board->total_holes;
+}
+
+// Play game_count random games, comparing the board metrics with
+// recompute_metrics after every piece. Returns the number of games in
+// which they disagreed.
+int run_metric_check(int game_count, unsigned int base_seed) {
+    int failures = 0;
+    long clears = 0;
+    long clears_over_holes = 0;
+    for (int i = 0; i < game_count; i++) {
+        TetrisGame game;
+        init_game(&game, base_seed + i);
+        while (!game.game_over && game.pieces_placed < BENCH_MAX_PIECES) {
+            int lines = game.lines_cleared;
+            int holes = game.board.total_holes;
+            play_random_piece(&game);
+            if (game.lines_cleared > lines) {
+                clears++;
+                clears_over_holes += holes > 0;
+            }
+            if (!metrics_match(&game.board)) {
+                printf("Seed %u: metrics wrong after piece %ld\n", base_seed + i, game.pieces_placed);
+                failures++;
+                break;
+            }
+        }
+    }
+    printf("%d of %d games kept matching metrics over %ld line clears (%ld with holes on the board)\n",
+           game_count - failures, game_count, clears, clears_over_holes);
+    return failures;
+}
+
+// Battle mode: many boards stored contiguously, each placing one piece per
+// tick. Boards are stepped in chunks on the worker pool; garbage produced
+// during a tick is routed afterwards on one thread, in board order, so the
+// outcome does not depend on the thread count.
+typedef struct {
+    TetrisGame *games;   // Contiguous board state
+    int *pending;        // Garbage lines waiting to be inserted
+    int *outgoing;       // Garbage lines produced this tick
+    int board_count;
+    long ticks;
+    long garbage_sent;
+} Battle;
+
+// Garbage sent for 0-4 lines cleared at once
+const int garbage_for_lines[5] = { 0, 0, 1, 2, 4 };
+
+void init_battle(Battle *battle, int board_count, unsigned int seed) {
+    battle->games = calloc(board_count, sizeof(TetrisGame));
+    battle->pending = calloc(board_count, sizeof(int));
+    battle->outgoing = calloc(board_count, sizeof(int));
+    battle->board_count = board_count;
+    battle->ticks = 0;
+    battle->garbage_sent = 0;
+    for (int i = 0; i < board_count; i++) {
+        init_game(&battle->games[i], seed + i);
+    }
+}
+
+void free_battle(Battle *battle) {
+    free(battle->games);
+    free(battle->pending);
+    free(battle->outgoing);
+}
+
+void battle_chunk(void *context, int chunk) {
+    Battle *battle = context;
+    int first = chunk * BATTLE_CHUNK;
+    int last = first + BATTLE_CHUNK < battle->board_count ? first + BATTLE_CHUNK : battle->board_count;
+
+    for (int i = first; i < last; i++) {
+        TetrisGame *game = &battle->games[i];
+        battle->outgoing[i] = 0;
+        if (game->game_over) {
+            continue;
+        }
+        if (battle->pending[i] > 0) {
+            add_garbage(game, battle->pending[i], next_random(&game->rng_state) % WIDTH);
+            battle->pending[i] = 0;
+            if (game->game_over) {
+                continue;
+            }
+        }
+        int lines_before = game->lines_cleared;
+        play_greedy_piece(game);
+        int lines = game->lines_cleared - lines_before;
+        battle->outgoing[i] = garbage_for_lines[lines < 4 ? lines : 4];
+    }
+}
+
+// One tick: every live board places a piece, then garbage is routed.
+// Returns the number of boards still alive.
+int step_battle(Battle *battle, ThreadPool *pool) {
+    int chunks = (battle->board_count + BATTLE_CHUNK - 1) / BATTLE_CHUNK;
+    run_pool(pool, chunks, battle_chunk, battle);
+    battle->ticks++;
+
+    int alive = 0;
+    for (int i = 0; i < battle->board_count; i++) {
+        alive += !battle->games[i].game_over;
+    }
+    for (int i = 0; i < battle->board_count && alive > 1; i++) {
+        int lines = battle->outgoing[i];
+        if (lines == 0 || battle->games[i].game_over) {
+            continue;
+        }
+        // Cancel incoming garbage first, then attack the next live board
+        int cancelled = lines < battle->pending[i] ? lines : battle->pending[i];
+        battle->pending[i] -= cancelled;
+        lines -= cancelled;
+        int target = i;
+        do {
+            target = (target + 1) % battle->board_count;
+        } while (battle->games[target].game_over);
+        battle->pending[target] += lines;
+        battle->garbage_sent += lines;
+    }
+    return alive;
+}
+
+typedef struct {
+    double seconds;
+    long ticks;
+    long placements;
+    int survivors;
+    uint64_t checksum;
+} BattleResult;
+
+BattleResult run_battle(int board_count, int thread_count, long max_ticks, unsigned int seed) {
+    BattleResult result = {0};
+    Battle battle;
+    ThreadPool pool;
+    init_battle(&battle, board_count, seed);
+    init_pool(&pool, thread_count);
+
+    double start = seconds_now();
+    int alive = board_count;
+    while (battle.ticks < max_ticks && alive > 1) {
+        alive = step_battle(&battle, &pool);
+    }
+    result.seconds = seconds_now() - start;
+    destroy_pool(&pool);
+
+    result.ticks = battle.ticks;
+    result.checksum = 0xCBF29CE484222325ull;
+    for (int i = 0; i < board_count; i++) {
+        result.placements += battle.games[i].pieces_placed;
+        result.survivors += !battle.games[i].game_over;
+        result.checksum = (result.checksum ^ hash_game(&battle.games[i])) * 0x100000001B3ull;
+    }
+    free_battle(&battle);
+    return result;
+}
+
+void print_battle_result(int board_count, int thread_count, BattleResult result) {
+    printf("boards %5d  threads %2d  ticks %5ld  %8.0f ticks/sec  %9.0f placements/sec  "
+           "survivors %d  checksum %016llx\n",
+           board_count, thread_count, result.ticks, result.ticks / result.seconds,
+           result.placements / result.seconds, result.survivors,
+           (unsigned long long)result.checksum);
+}
+
+// Run one battle, or a sweep over board and thread counts to show scaling
+void run_battle_mode(int board_count, int thread_count, long max_ticks, unsigned int seed) {
+    if (board_count > 0) {
+        print_battle_result(board_count, thread_count,
+                            run_battle(board_count, thread_count, max_ticks, seed));
+        return;
+    }
+    const int board_counts[] = { 100, 300, 1000 };
+    int cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    for (int i = 0; i < 3; i++) {
+        for (int threads = 1; ; threads *= 2) {
+            if (threads > cores) threads = cores;
+            print_battle_result(board_counts[i], threads,
+                                run_battle(board_counts[i], threads, max_ticks, seed));
+            if (threads == cores) break;
+        }
+    }
+}
+
+// Giant-board stress mode. Rows are stored bottom-up as runs of 64-bit
+// words in a slot pool and reached through a ring of slot indices, so
+// removing a line moves at most half of the stack's slot indices and never
+// copies cells. Only rows up to the top of the stack are stored; everything
+// above it is implicitly empty.
+typedef struct {
+    int width;
+    int height;
+    int words;            // 64-bit words per row
+    uint64_t *full_row;   // Every playfield bit set
+    uint64_t *cells;      // Row storage, `words` per slot
+    int slot_capacity;
+    int slots_used;
+    int *free_slots;
+    int free_count;
+    int *ring;            // Slot of each stored row, floor first
+    int ring_capacity;    // Power of two
+    int ring_head;
+    int stack_rows;
+    long *column_tops;    // Column height plus rows_removed, so clears are O(1)
+    long rows_removed;
+} GiantBoard;
+
+// Piece geometry from the bottom of the 4x4 box up
+uint32_t giant_rows[7][4][BLOCK_SIZE];
+int giant_bottom[7][4][BLOCK_SIZE]; // Lowest cell per column, -1 if empty
+int giant_top[7][4][BLOCK_SIZE];    // Highest cell per column + 1
+
+void init_giant_shapes() {
+    for (int type = 0; type < 7; type++) {
+        for (int rotation = 0; rotation < 4; rotation++) {
+            for (int x = 0; x < BLOCK_SIZE; x++) {
+                giant_bottom[type][rotation][x] = -1;
+                giant_top[type][rotation][x] = 0;
+            }
+            for (int r = 0; r < BLOCK_SIZE; r++) {
+                uint32_t mask = piece_masks[type][rotation][BLOCK_SIZE - 1 - r];
+                giant_rows[type][rotation][r] = mask;
+                for (int x = 0; x < BLOCK_SIZE; x++) {
+                    if (mask & (1u << x)) {
+                        if (giant_bottom[type][rotation][x] < 0) {
+                            giant_bottom[type][rotation][x] = r;
+                        }
+                        giant_top[type][rotation][x] = r + 1;
+                    }
+                }
+            }
+        }
+    }
+}
+
+void init_giant_board(GiantBoard *board, int width, int height) {
+    memset(board, 0, sizeof(*board));
+    board->width = width;
+    board->height = height;
+    board->words = (width + 63) / 64;
+    board->full_row = calloc(board->words, sizeof(uint64_t));
+    for (int x = 0; x < width; x++) {
+        board->full_row[x / 64] |= 1ull << (x % 64);
+    }
+    board->column_tops = calloc(width, sizeof(long));
+    board->ring_capacity = 16;
+    board->ring = malloc(board->ring_capacity * sizeof(int));
+}
+
+void free_giant_board(GiantBoard *board) {
+    free(board->full_row);
+    free(board->cells);
+    free(board->free_slots);
+    free(board->ring);
+    free(board->column_tops);
+}
+
+size_t giant_board_bytes(const GiantBoard *board) {
+    return board->slot_capacity * (board->words * sizeof(uint64_t) + sizeof(int)) +
+           board->ring_capacity * sizeof(int) +
+           board->width * sizeof(long) + board->words * sizeof(uint64_t);
+}
+
+uint64_t *giant_row(const GiantBoard *board, int row) {
+    int slot = board->ring[(board->ring_head + row) & (board->ring_capacity - 1)];
+    return board->cells + (size_t)slot * board->words;
+}
+
+int column_height(const GiantBoard *board, int x) {
+    return (int)(board->column_tops[x] - board->rows_removed);
+}
+
+// Store a new empty row on top of the stack
+void giant_push_row(GiantBoard *board) {
+    int slot;
+    if (board->free_count > 0) {
+        slot = board->free_slots[--board->free_count];
+    } else {
+        if (board->slots_used == board->slot_capacity) {
+            board->slot_capacity = board->slot_capacity ? board->slot_capacity * 2 : 16;
+            board->cells = realloc(board->cells,
+                                   (size_t)board->slot_capacity * board->words * sizeof(uint64_t));
+            board->free_slots = realloc(board->free_slots, board->slot_capacity * sizeof(int));
+        }
+        slot = board->slots_used++;
+    }
+    memset(board->cells + (size_t)slot * board->words, 0, board->words * sizeof(uint64_t));
+
+    if (board->stack_rows == board->ring_capacity) {
+        // Grow the ring and unwrap it so row 0 sits at index 0
+        int *ring = malloc(board->ring_capacity * 2 * sizeof(int));
+        for (int i = 0; i < board->stack_rows; i++) {
+            ring[i] = board->ring[(board->ring_head + i) & (board->ring_capacity - 1)];
+        }
+        free(board->ring);
+        board->ring = ring;
+        board->ring_capacity *= 2;
+        board->ring_head = 0;
+    }
+    board->ring[(board->ring_head + board->stack_rows) & (board->ring_capacity - 1)] = slot;
+    board->stack_rows++;
+}
+
+bool giant_cell(const GiantBoard *board, int row, int x) {
+    return giant_row(board, row)[x / 64] >> (x % 64) & 1;
+}
+
+// Unlink a full row. Whichever side of it is shorter has its slot indices
+// moved by one, so this costs up to half the stack's height in 4-byte
+// moves rather than O(1); no cells are copied.
+void giant_remove_row(GiantBoard *board, int row) {
+    int mask = board->ring_capacity - 1;
+    int *ring = board->ring;
+    int head = board->ring_head;
+    board->free_slots[board->free_count++] = ring[(head + row) & mask];
+
+    if (row < board->stack_rows - 1 - row) {
+        for (int i = row; i > 0; i--) {
+            ring[(head + i) & mask] = ring[(head + i - 1) & mask];
+        }
+        board->ring_head = (head + 1) & mask;
+    } else {
+        for (int i = row; i < board->stack_rows - 1; i++) {
+            ring[(head + i) & mask] = ring[(head + i + 1) & mask];
+        }
+    }
+    board->stack_rows--;
+    // Every column has a cell in a full row, so every height drops by one
+    board->rows_removed++;
+
+    // Where the row was a column's top, the empty cells under it were holes
+    // and the top drops to the next filled cell. Those columns are empty in
+    // the row that has moved down into its place, if there is one.
+    for (int word = 0; word < board->words; word++) {
+        uint64_t empty = row < board->stack_rows ? ~giant_row(board, row)[word] : ~0ull;
+        empty &= board->full_row[word];
+        for (; empty; empty &= empty - 1) {
+            int x = word * 64 + __builtin_ctzll(empty);
+            int height = column_height(board, x);
+            if (height != row) {
+                continue;
+            }
+            while (height > 0 && !giant_cell(board, height - 1, x)) {
+                height--;
+            }
+            board->column_tops[x] = height + board->rows_removed;
+        }
+    }
+}
+
+bool giant_row_full(const GiantBoard *board, const uint64_t *row) {
+    const uint64_t *full = board->full_row;
+    int i = 0;
+#if defined(__AVX2__)
+    for (; i + 4 <= board->words; i += 4) {
+        __m256i cells = _mm256_loadu_si256((const __m256i *)(row + i));
+        __m256i mask = _mm256_loadu_si256((const __m256i *)(full + i));
+        if (!_mm256_testc_si256(cells, mask)) {
+            return false;
+        }
+    }
+#elif defined(__SSE2__)
+    for (; i + 2 <= board->words; i += 2) {
+        __m128i cells = _mm_loadu_si128((const __m128i *)(row + i));
+        __m128i mask = _mm_loadu_si128((const __m128i *)(full + i));
+        __m128i equal = _mm_cmpeq_epi32(_mm_and_si128(cells, mask), mask);
+        if (_mm_movemask_epi8(equal) != 0xFFFF) {
+            return false;
+        }
+    }
+#endif
+    for (; i < board->words; i++) {
+        if ((row[i] & full[i]) != full[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Row (from the floor) where the bottom of the piece box comes to rest when
+// dropped straight down at column x. Costs O(piece width).
+int giant_landing(const GiantBoard *board, int type, int rotation, int x) {
+    int base = -BLOCK_SIZE;
+    for (int c = 0; c < BLOCK_SIZE; c++) {
+        int bottom = giant_bottom[type][rotation][c];
+        if (bottom >= 0) {
+            int rest = column_height(board, x + c) - bottom;
+            if (rest > base) base = rest;
+        }
+    }
+    return base;
+}
+
+// Merge a dropped piece and remove the lines it completes. Returns the
+// number of lines, or -1 if the piece sticks out of the top.
+int giant_lock(GiantBoard *board, int type, int rotation, int x) {
+    int base = giant_landing(board, type, rotation, x);
+    int touched[BLOCK_SIZE];
+    int touched_count = 0;
+
+    for (int r = 0; r < BLOCK_SIZE; r++) {
+        uint32_t mask = giant_rows[type][rotation][r];
+        if (!mask) {
+            continue;
+        }
+        int row = base + r;
+        if (row >= board->height) {
+            return -1;
+        }
+        while (board->stack_rows <= row) {
+            giant_push_row(board);
+        }
+        uint64_t *cells = giant_row(board, row);
+        for (uint32_t bits = mask; bits; bits &= bits - 1) {
+            int column = x + __builtin_ctz(bits);
+            cells[column / 64] |= 1ull << (column % 64);
+        }
+        touched[touched_count++] = row;
+    }
+    for (int c = 0; c < BLOCK_SIZE; c++) {
+        if (giant_bottom[type][rotation][c] >= 0) {
+            board->column_tops[x + c] = base + giant_top[type][rotation][c] + board->rows_removed;
+        }
+    }
+
+    // Only the rows the piece touched can have become full; remove them
+    // top-down so the lower row numbers stay valid
+    int lines = 0;
+    for (int i = touched_count - 1; i >= 0; i--) {
+        if (giant_row_full(board, giant_row(board, touched[i]))) {
+            giant_remove_row(board, touched[i]);
+            lines++;
+        }
+    }
+    return lines;
+}
+
+// Leftmost and rightmost occupied columns of a piece
+void piece_columns(int type, int rotation, int *first, int *last) {
+    *first = BLOCK_SIZE;
+    *last = -1;
+    for (int c = 0; c < BLOCK_SIZE; c++) {
+        if (giant_bottom[type][rotation][c] >= 0) {
+            if (c < *first) *first = c;
+            *last = c;
+        }
+    }
+}
+
+// Stress policy: try every rotation in a window of columns that sweeps
+// across the board, preferring drops that leave no gaps under the piece
+// and then the lowest resting spot. Costs the same on any board size.
+void choose_giant_drop(const GiantBoard *board, int type, int window_start,
+                       int *best_rotation, int *best_x) {
+    long best_cost = -1;
+    int window = board->width < GIANT_WINDOW ? board->width : GIANT_WINDOW;
+    for (int rotation = 0; rotation < 4; rotation++) {
+        int first, last;
+        piece_columns(type, rotation, &first, &last);
+        for (int i = 0; i < window; i++) {
+            int x = (window_start + i) % board->width - first;
+            if (x + last >= board->width) {
+                x = board->width - 1 - last;
+            }
+            int base = giant_landing(board, type, rotation, x);
+            long gaps = 0;
+            for (int c = first; c <= last; c++) {
+                gaps += base + giant_bottom[type][rotation][c] - column_height(board, x + c);
+            }
+            // Surface roughness across the piece and its two neighbours
+            long bumpiness = 0;
+            int previous = x + first > 0 ? column_height(board, x + first - 1) : -1;
+            for (int c = first; c <= last + 1; c++) {
+                int height;
+                if (c <= last) {
+                    height = base + giant_top[type][rotation][c];
+                } else if (x + c < board->width) {
+                    height = column_height(board, x + c);
+                } else {
+                    break;
+                }
+                if (previous >= 0) {
+                    bumpiness += abs(height - previous);
+                }
+                previous = height;
+            }
+            long cost = gaps * 1000 + bumpiness * 10 + base * 50;
+            if (best_cost < 0 || cost < best_cost) {
+                best_cost = cost;
+                *best_rotation = rotation;
+                *best_x = x;
+            }
+        }
+    }
+}
+
+typedef struct {
+    long pieces;
+    long lines;
+    long top_outs;
+    int max_stack;
+    size_t board_bytes;
+    double seconds;
+} GiantResult;
+
+GiantResult run_giant(int width, int height, long pieces, unsigned int seed) {
+    GiantResult result = {0};
+    GiantBoard board;
+    init_giant_board(&board, width, height);
+    unsigned int rng_state = seed;
+    int window_start = 0;
+
+    double start = seconds_now();
+    for (long i = 0; i < pieces; i++) {
+        int type = next_random(&rng_state) % 7;
+        int rotation = 0;
+        int x = 0;
+        choose_giant_drop(&board, type, window_start, &rotation, &x);
+        int lines = giant_lock(&board, type, rotation, x);
+        if (lines < 0) {
+            // Topped out: start over on a fresh board
+            result.top_outs++;
+            free_giant_board(&board);
+            init_giant_board(&board, width, height);
+            continue;
+        }
+        result.lines += lines;
+        if (board.stack_rows > result.max_stack) result.max_stack = board.stack_rows;
+        window_start = (window_start + GIANT_WINDOW / 4) % width;
+    }
+    result.seconds = seconds_now() - start;
+    result.pieces = pieces;
+    result.board_bytes = giant_board_bytes(&board);
+    free_giant_board(&board);
+    return result;
+}
+
+void print_giant_result(int width, int height, GiantResult result) {
+    printf("%5d x %-8d pieces %ld  lines %ld  top-outs %ld  %.1f ns/piece  "
+           "max stack %d rows  board memory %zu bytes\n",
+           width, height, result.pieces, result.lines, result.top_outs,
+           result.seconds * 1e9 / result.pieces, result.max_stack, result.board_bytes);
+}
+
+// Run the stress variant on one board, or on a range of sizes to show
+// that per-piece cost and memory do not grow with the board
+void run_giant_mode(int width, int height, long pieces, unsigned int seed) {
+    init_giant_shapes();
+    if (width > 0) {
+        print_giant_result(width, height, run_giant(width, height, pieces, seed));
+        return;
+    }
+    const int sizes[][2] = { {10, 20}, {64, 1000}, {256, 100000}, {1024, 1000000} };
+    for (int i = 0; i < 4; i++) {
+        print_giant_result(sizes[i][0], sizes[i][1],
+                           run_giant(sizes[i][0], sizes[i][1], pieces, seed));
+    }
+}
+
+// Re-run a recorded game headless at full speed and check that it ends
+// with the recorded score and board. Returns false on any mismatch.
+bool replay_recording(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        printf("%s: cannot open\n", path);
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    unsigned char *data = malloc(size > 0 ? size : 1);
+    bool read_ok = size > 0 && fread(data, 1, size, file) == (size_t)size;
+    fclose(file);
+
+    const unsigned char *p = data;
+    const unsigned char *end = data + (read_ok ? size : 0);
+    uint64_t seed;
+    if (end - p < 5 || memcmp(p, RECORDING_MAGIC, 4) != 0 || p[4] != RECORDING_VERSION ||
+        (p += 5, !get_varint(&p, end, &seed))) {
+        printf("%s: not a recording\n", path);
+        free(data);
+        return false;
+    }
+
+    double start = seconds_now();
+    TetrisGame game;
+    init_game(&game, (unsigned int)seed);
+    long tick = 0;
+    uint64_t expected[4];
+    bool complete = false;
+    while (p < end) {
+        uint64_t delta;
+        if (!get_varint(&p, end, &delta) || p >= end) {
+            break;
+        }
+        int code = *p++;
+        tick += delta;
+        while (game.ticks < (code ? tick - 1 : tick) && !game.game_over) {
+            run_tick(&game, ERR);
+        }
+        if (code == 0) {
+            complete = get_varint(&p, end, &expected[0]) && get_varint(&p, end, &expected[1]) &&
+                       get_varint(&p, end, &expected[2]) && get_varint(&p, end, &expected[3]);
+            break;
+        }
+        if (!game.game_over) {
+            run_tick(&game, code_to_key(code));
+        }
+    }
+    double elapsed = seconds_now() - start;
+    free(data);
+
+    if (!complete) {
+        printf("%s: truncated recording\n", path);
+        return false;
+    }
+    bool match = expected[0] == (uint64_t)game.score && expected[1] == (uint64_t)game.lines_cleared &&
+                 expected[2] == (uint64_t)game.pieces_placed && expected[3] == hash_game(&game);
+    printf("%s: %s  score %d/%llu  lines %d/%llu  pieces %ld/%llu  ticks %ld in %.3f ms\n",
+           path, match ? "OK" : "MISMATCH",
+           game.score, (unsigned long long)expected[0],
+           game.lines_cleared, (unsigned long long)expected[1],
+           game.pieces_placed, (unsigned long long)expected[2],
+           game.ticks, elapsed * 1e3);
+    return match;
+}
+
+void print_usage(const char *program) {
+    fprintf(stderr, "Usage: %s [--ai [budget_us]] [--record file]   play in the terminal\n", program);
+    fprintf(stderr, "       %s --bench [games] [threads] [seed] [--ai [budget_us]]\n", program);
+    fprintf(stderr, "                                             headless benchmark\n");
+    fprintf(stderr, "       %s --replay file...                 verify recorded games\n", program);
+    fprintf(stderr, "       %s --check [games] [seed]           verify the incremental board metrics\n", program);
+    fprintf(stderr, "       %s --battle [boards] [threads] [ticks] [seed]\n", program);
+    fprintf(stderr, "                                             many-board versus benchmark\n");
+    fprintf(stderr, "       %s --giant [width height] [pieces] [seed]\n", program);
+    fprintf(stderr, "                                             large-board stress run\n");
+}
+
+// Parse an optional "--ai [budget_us]" at argv[*i], advancing *i past it.
+// Returns 0 if absent.
+long parse_ai_option(int argc, char *argv[], int *i) {
+    if (*i >= argc || strcmp(argv[*i], "--ai") != 0) {
+        return 0;
+    }
+    long budget = AI_BUDGET_US;
+    if (*i + 1 < argc && argv[*i + 1][0] != '-') {
+        budget = atol(argv[++*i]);
+    }
+    ++*i;
+    return budget > 0 ? budget : AI_BUDGET_US;
+}
+
+int main(int argc, char *argv[]) {
+    TetrisAI *ai = NULL;
+    long ai_budget_us = 0;
+    const char *record_path = NULL;
+
+    // Shared by every game, so built once before any worker threads start
+    init_piece_masks();
+
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        int positional = 2;
+        while (positional < argc && positional < 5 && argv[positional][0] != '-') {
+            positional++;
+        }
+        int games = positional > 2 ? atoi(argv[2]) : BENCH_GAMES;
+        int threads = positional > 3 ? atoi(argv[3]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+        unsigned int seed = positional > 4 ? (unsigned int)atoi(argv[4]) : 1;
+        ai_budget_us = parse_ai_option(argc, argv, &positional);
+        if (games < 1) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        run_benchmark(games, threads, seed, ai_budget_us);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--replay") == 0) {
+        if (argc < 3) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        int failures = 0;
+        for (int i = 2; i < argc; i++) {
+            failures += !replay_recording(argv[i]);
+        }
+        printf("%d of %d recordings match\n", argc - 2 - failures, argc - 2);
+        return failures ? 1 : 0;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--check") == 0) {
+        int games = argc > 2 ? atoi(argv[2]) : BENCH_GAMES;
+        unsigned int seed = argc > 3 ? (unsigned int)atoi(argv[3]) : 1;
+        if (games < 1 || argc > 4) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        return run_metric_check(games, seed) ? 1 : 0;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--battle") == 0) {
+        int boards = argc > 2 ? atoi(argv[2]) : BATTLE_BOARDS;
+        int threads = argc > 3 ? atoi(argv[3]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+        long ticks = argc > 4 ? atol(argv[4]) : BATTLE_TICKS;
+        unsigned int seed = argc > 5 ? (unsigned int)atoi(argv[5]) : 1;
+        if (boards < 0 || ticks < 1) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        run_battle_mode(boards, threads, ticks, seed);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--giant") == 0) {
+        int width = argc > 3 ? atoi(argv[2]) : 0;
+        int height = argc > 3 ? atoi(argv[3]) : 0;
+        long pieces = argc > 4 ? atol(argv[4]) : GIANT_PIECES;
+        unsigned int seed = argc > 5 ? (unsigned int)atoi(argv[5]) : 1;
+        if (argc == 3 || (argc > 3 && (width < BLOCK_SIZE || width > GIANT_MAX_WIDTH ||
+                                       height < BLOCK_SIZE)) || pieces < 1) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        run_giant_mode(width, height, pieces, seed);
+        return 0;
+    }
+
+    int i = 1;
+    while (i < argc) {
+        if (strcmp(argv[i], "--ai") == 0) {
+            ai_budget_us = parse_ai_option(argc, argv, &i);
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_path = argv[i + 1];
+            i += 2;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (ai_budget_us > 0) {
+        ai = malloc(sizeof(TetrisAI));
+        init_ai(ai, ai_budget_us);
+    }
+
+    Recording recording;
+    Runtime runtime;
+    if (!runtime_init(&runtime, TICK_MS * 1000)) {
+        fprintf(stderr, "Could not create the tick timer\n");
+        return 1;
+    }
+    init_screen();
+    game_loop(ai, record_path ? &recording : NULL, &runtime);
+    frame_end();
+    runtime_report(&runtime, stderr);
+    runtime_close(&runtime);
+    if (ai) {
+        free_ai(ai);
+        free(ai);
+    }
+    if (record_path) {
+        if (!save_recording(&recording, record_path)) {
+            fprintf(stderr, "Could not write recording to %s\n", record_path);
+            return 1;
+        }
+        free(recording.data);
+    }
     return 0;
 }
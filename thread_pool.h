@@ -0,0 +1,104 @@
+// Fixed pool of worker threads shared by the games' headless modes.
+//
+// run_pool hands out item indices through an atomic counter, so items are
+// load-balanced across workers; callers that need results independent of
+// the thread count write them per item and combine them afterwards.
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+// Fixed set of worker threads that run parallel loops over item indices
+typedef struct {
+    pthread_t *threads;
+    int thread_count;
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;
+    pthread_cond_t work_done;
+    void (*task)(void *context, int item);
+    void *context;
+    int item_count;
+    atomic_int next_item;
+    int busy_workers;
+    int generation;
+    bool shutdown;
+} ThreadPool;
+
+static void *pool_worker(void *arg) {
+    ThreadPool *pool = arg;
+    int seen_generation = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    while (true) {
+        while (!pool->shutdown && pool->generation == seen_generation) {
+            pthread_cond_wait(&pool->work_ready, &pool->lock);
+        }
+        if (pool->shutdown) {
+            break;
+        }
+        seen_generation = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        int item;
+        while ((item = atomic_fetch_add(&pool->next_item, 1)) < pool->item_count) {
+            pool->task(pool->context, item);
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->busy_workers == 0) {
+            pthread_cond_signal(&pool->work_done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+static void init_pool(ThreadPool *pool, int thread_count) {
+    if (thread_count < 1) thread_count = 1;
+    pool->threads = malloc(thread_count * sizeof(pthread_t));
+    pool->thread_count = thread_count;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->work_done, NULL);
+    pool->generation = 0;
+    pool->busy_workers = 0;
+    pool->shutdown = false;
+    for (int i = 0; i < thread_count; i++) {
+        pthread_create(&pool->threads[i], NULL, pool_worker, pool);
+    }
+}
+
+// Run task(context, i) for every i in [0, item_count) and wait for completion
+static void run_pool(ThreadPool *pool, int item_count, void (*task)(void *, int), void *context) {
+    pthread_mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->context = context;
+    pool->item_count = item_count;
+    atomic_store(&pool->next_item, 0);
+    pool->busy_workers = pool->thread_count;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work_ready);
+    while (pool->busy_workers > 0) {
+        pthread_cond_wait(&pool->work_done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void destroy_pool(ThreadPool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->thread_count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_cond_destroy(&pool->work_done);
+    free(pool->threads);
+}
+
+#endif